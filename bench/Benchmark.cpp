@@ -0,0 +1,253 @@
+#include "ConsensusArray.hpp"
+#include "SynchronousConsensusArray.hpp"
+#include "LatticeInitialiser.hpp"
+#include "ThreadAffinity.hpp"
+#include "Timer.hpp"
+#include <boost/program_options.hpp>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <set>
+
+/**
+ *\file
+ *\brief Benchmark of the lattice update throughput as the lattice outgrows the caches.
+ *
+ * For each lattice side and memory layout a randomised lattice is swept a number of times and the
+ * time per update attempt is reported, together with the species fractions at the end so that the
+ * layouts can be checked to give the same statistics. The "synchronous" layout is the row major
+ * lattice updated synchronously on every hardware thread; it reads and writes each cell once per
+ * sweep, so 2 / (ns/update) is the memory bandwidth it reaches in GB/s. A row major lattice is run
+ * once for each --prefetch distance, 0 being the plain serial loop, to show how much of the memory
+ * latency the update pipeline hides as the lattice outgrows each cache level.
+ *
+ * With --scaling every thread sweeps a lattice of its own, pinned with each --affinity policy, and
+ * the combined throughput is reported for each thread count. The lattices are either first touched
+ * by the thread that sweeps them ("owner"), which puts each in its own socket's memory, or all by
+ * the main thread ("main"), which puts them on one NUMA node, so comparing compact against scatter
+ * and owner against main shows what a second socket and local memory are worth.
+ */
+namespace
+{
+    /// Runs function(thread) on threadCount threads pinned by affinity and waits for them.
+    template<typename Function>
+    void runPinned(const ThreadAffinity &affinity, int threadCount, Function function)
+    {
+        std::vector<std::thread> workers;
+        for(int thread = 0; thread < threadCount; ++thread)
+        {
+            workers.emplace_back([&affinity, &function, thread]() {
+                affinity.pin(thread);
+                function(thread);
+            });
+        }
+        for(auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    /// Runs the scaling benchmark, one lattice per thread.
+    void scaling(int size, ConsensusArray::Layout layout, int tileSize, int sweeps, double p_1, double p_2, unsigned int seed,
+        const std::vector<int> &threadCounts, const std::vector<std::string> &policies, const std::vector<std::string> &firstTouches)
+    {
+        std::vector<std::vector<int>> nodes = ThreadAffinity::numaNodes();
+        std::cout << "NUMA nodes: " << nodes.size() << ", cpus per node:";
+        for(const auto &node : nodes)
+        {
+            std::cout << ' ' << node.size();
+        }
+        std::cout << "\nlattice side " << size << " per thread\n";
+
+        int columnWidth = 14;
+        std::cout << std::setw(columnWidth) << "threads" << std::setw(columnWidth) << "affinity"
+                  << std::setw(columnWidth) << "first-touch" << std::setw(columnWidth) << "nodes used"
+                  << std::setw(columnWidth) << "Mupdates/s" << std::setw(columnWidth) << "per thread" << '\n';
+
+        for(const auto &policy : policies)
+        {
+            ThreadAffinity affinity(policy);
+            for(const auto &firstTouch : firstTouches)
+            {
+                for(int threadCount : threadCounts)
+                {
+                    std::vector<std::unique_ptr<ConsensusArray>> lattices(static_cast<std::size_t>(threadCount));
+
+                    auto build = [&](int thread) {
+                        std::default_random_engine generator(seed + thread);
+                        lattices[thread].reset(new ConsensusArray(LatticeStorage(static_cast<long long>(size) * size), size, size, p_1, p_2, layout, tileSize));
+                        LatticeInitialiser(generator, 1).random(*lattices[thread]);
+                    };
+
+                    if("main" == firstTouch)
+                    {
+                        // One thread, on the first worker's cpu, touches every lattice.
+                        runPinned(affinity, 1, [&](int) {
+                            for(int thread = 0; thread < threadCount; ++thread)
+                            {
+                                build(thread);
+                            }
+                        });
+                    }
+                    else
+                    {
+                        runPinned(affinity, threadCount, build);
+                    }
+
+                    Timer timer;
+                    runPinned(affinity, threadCount, [&](int thread) {
+                        // Each generator lives on its own thread's stack, so no two threads write to one cache line.
+                        std::default_random_engine generator(seed + threadCount + thread);
+                        for(int sweep = 0; sweep < sweeps; ++sweep)
+                        {
+                            lattices[thread]->sweep(generator);
+                        }
+                    });
+                    double elapsed = timer.elapsed();
+
+                    std::set<int> nodesUsed;
+                    for(int thread = 0; thread < threadCount; ++thread)
+                    {
+                        for(std::size_t node = 0; node < nodes.size(); ++node)
+                        {
+                            for(int cpu : nodes[node])
+                            {
+                                if(cpu == affinity.cpu(thread))
+                                {
+                                    nodesUsed.insert(static_cast<int>(node));
+                                }
+                            }
+                        }
+                    }
+
+                    double updates = static_cast<double>(size) * size * sweeps * threadCount;
+                    std::cout << std::setw(columnWidth) << threadCount << std::setw(columnWidth) << policy
+                              << std::setw(columnWidth) << firstTouch
+                              << std::setw(columnWidth) << (affinity.cpu(0) < 0 ? std::string("any") : std::to_string(nodesUsed.size()))
+                              << std::setw(columnWidth) << updates / elapsed / 1e6
+                              << std::setw(columnWidth) << updates / elapsed / 1e6 / threadCount << std::endl;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    std::vector<int> sizes;
+    std::vector<std::string> layouts;
+    int sweeps;
+    int tileSize;
+    double p_1;
+    double p_2;
+    unsigned int seed;
+    std::vector<int> threadCounts;
+    std::vector<std::string> policies;
+    std::vector<std::string> firstTouches;
+    std::vector<int> prefetchDistances;
+
+    boost::program_options::options_description desc("Options for Consensus benchmark");
+
+    desc.add_options()
+
+        ("sizes", boost::program_options::value<std::vector<int>>(&sizes)->multitoken()->default_value(std::vector<int>{1024, 4096, 8192, 16384}, "1024 4096 8192 16384"), "Lattice sides to benchmark.")
+        ("layouts", boost::program_options::value<std::vector<std::string>>(&layouts)->multitoken()->default_value(std::vector<std::string>{"rowmajor", "tiled"}, "rowmajor tiled"), "Memory layouts to benchmark: rowmajor, tiled or synchronous.")
+        ("sweeps,s", boost::program_options::value<int>(&sweeps)->default_value(1), "The number of sweeps timed for each lattice.")
+        ("tile-size", boost::program_options::value<int>(&tileSize)->default_value(64), "Side of a tile in the tiled layout.")
+        ("p_1,p", boost::program_options::value<double>(&p_1)->default_value(1), "Value of p_1 in simulation.")
+        ("p_2,q", boost::program_options::value<double>(&p_2)->default_value(1), "Value of p_2 in simulation.")
+        ("prefetch", boost::program_options::value<std::vector<int>>(&prefetchDistances)->multitoken()->default_value(std::vector<int>{0, ConsensusArray::defaultPrefetchDistance}, "0 32"), "Prefetch distances the row major layout is run with, 0 turns the update pipeline off.")
+        ("seed", boost::program_options::value<unsigned int>(&seed)->default_value(1), "Seed of the random number generator.")
+        ("scaling", "Run the multi-socket scaling benchmark, one lattice of the first size and layout per thread.")
+        ("threads,t", boost::program_options::value<std::vector<int>>(&threadCounts)->multitoken()->default_value(std::vector<int>{1, 2, 4, 8}, "1 2 4 8"), "Thread counts of the scaling benchmark.")
+        ("affinity", boost::program_options::value<std::vector<std::string>>(&policies)->multitoken()->default_value(std::vector<std::string>{"compact", "scatter"}, "compact scatter"), "Thread pinning policies of the scaling benchmark: none, compact, scatter or a cpu list.")
+        ("first-touch", boost::program_options::value<std::vector<std::string>>(&firstTouches)->multitoken()->default_value(std::vector<std::string>{"owner", "main"}, "owner main"), "Which thread first touches each lattice in the scaling benchmark: owner or main.")
+        ("help,h", "Produce help message");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc,argv,desc), vm);
+    boost::program_options::notify(vm);
+
+    if(vm.count("help"))
+    {
+        std::cout << desc << '\n';
+        return 1;
+    }
+
+    // A misspelt layout would otherwise be benchmarked as row major under the wrong name.
+    for(const auto &layoutName : layouts)
+    {
+        if("rowmajor" != layoutName && "tiled" != layoutName && "synchronous" != layoutName)
+        {
+            std::cerr << "Unknown layout: " << layoutName << '\n';
+            return 1;
+        }
+    }
+    if(vm.count("scaling") && (layouts.empty() || "synchronous" == layouts.front()))
+    {
+        std::cerr << "The scaling benchmark needs a rowmajor or tiled layout.\n";
+        return 1;
+    }
+
+    if(vm.count("scaling"))
+    {
+        ConsensusArray::Layout layout = ("tiled" == layouts.front()) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+        scaling(sizes.front(), layout, tileSize, sweeps, p_1, p_2, seed, threadCounts, policies, firstTouches);
+        return 0;
+    }
+
+    int columnWidth = 14;
+    std::cout << std::setw(columnWidth) << "side" << std::setw(columnWidth) << "layout" << std::setw(columnWidth) << "prefetch"
+              << std::setw(columnWidth) << "ns/update" << std::setw(columnWidth) << "Mupdates/s"
+              << std::setw(columnWidth) << "red" << std::setw(columnWidth) << "green"
+              << std::setw(columnWidth) << "blue" << '\n';
+
+    for(int size : sizes)
+    {
+        for(const auto &layoutName : layouts)
+        {
+            ConsensusArray::Layout layout = ("tiled" == layoutName) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+            long long cells = static_cast<long long>(size) * size;
+
+            // Only the row major sweep has an update pipeline, the others are run once.
+            std::vector<int> distances = ("rowmajor" == layoutName) ? prefetchDistances : std::vector<int>{-1};
+            for(int distance : distances)
+            {
+                // Every layout starts from the same seed so the runs are directly comparable.
+                std::default_random_engine generator(seed);
+                std::unique_ptr<ConsensusArray> latticeOwner("synchronous" == layoutName
+                    ? new SynchronousConsensusArray(LatticeStorage(cells), size, size, p_1, p_2)
+                    : new ConsensusArray(LatticeStorage(cells), size, size, p_1, p_2, layout, tileSize));
+                ConsensusArray &lattice = *latticeOwner;
+                LatticeInitialiser(generator).random(lattice);
+                if(distance >= 0)
+                {
+                    lattice.setPrefetchDistance(distance);
+                }
+
+                Timer timer;
+                for(int sweep = 0; sweep < sweeps; ++sweep)
+                {
+                    lattice.sweep(generator);
+                }
+                double elapsed = timer.elapsed();
+
+                double updates = static_cast<double>(lattice.getSize()) * sweeps;
+
+                std::cout << std::setw(columnWidth) << size << std::setw(columnWidth) << layoutName
+                          << std::setw(columnWidth) << (distance >= 0 ? std::to_string(distance) : std::string("-"))
+                          << std::setw(columnWidth) << 1e9 * elapsed / updates
+                          << std::setw(columnWidth) << updates / elapsed / 1e6
+                          << std::setw(columnWidth) << lattice.stateFraction(ConsensusModel::Red)
+                          << std::setw(columnWidth) << lattice.stateFraction(ConsensusModel::Green)
+                          << std::setw(columnWidth) << lattice.stateFraction(ConsensusModel::Blue) << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "DistributedConsensusArray.hpp"
+
+namespace
+{
+    /// Number of rows owned by a rank when the rows are split as evenly as possible.
+    long long rowsOfRank(long long rows, int rank, int rankCount)
+    {
+        return rows / rankCount + (rank < rows % rankCount ? 1 : 0);
+    }
+
+    /// First row owned by a rank when the rows are split as evenly as possible.
+    long long firstRowOfRank(long long rows, int rank, int rankCount)
+    {
+        return rank * (rows / rankCount) + std::min<long long>(rank, rows % rankCount);
+    }
+}
+
+DistributedConsensusArray::DistributedConsensusArray(
+    std::default_random_engine &generator,
+    MPI_Comm communicator,
+    long long rows,
+    long long cols,
+    double prob1,
+    double prob2
+    ) : ConsensusModel(prob1, prob2),
+        m_communicator{communicator},
+        m_rank{0},
+        m_rankCount{1},
+        m_globalRows{rows},
+        m_colCount{cols},
+        m_local(0, 0)
+{
+    MPI_Comm_rank(m_communicator, &m_rank);
+    MPI_Comm_size(m_communicator, &m_rankCount);
+
+    m_firstRow  = firstRowOfRank(rows, m_rank, m_rankCount);
+    m_localRows = rowsOfRank(rows, m_rank, m_rankCount);
+
+    if(m_localRows < 4)
+    {
+        throw std::invalid_argument("Every rank needs at least four rows of the lattice.");
+    }
+
+    m_local = ConsensusArray(generator, m_localRows + 2, m_colCount, prob1, prob2);
+}
+
+long long DistributedConsensusArray::getFirstRow() const
+{
+    return m_firstRow;
+}
+
+long long DistributedConsensusArray::getLocalRows() const
+{
+    return m_localRows;
+}
+
+long long DistributedConsensusArray::getSize() const
+{
+    return m_globalRows * m_colCount;
+}
+
+void DistributedConsensusArray::exchangeRow(long long sendRow, int destination, long long receiveRow, int source)
+{
+    // Rows of a row major lattice are contiguous and one byte per cell.
+    const LatticeStorage &storage = m_local.getStorage();
+    const ConsensusModel::State *sendBuffer = storage.data() + sendRow * m_colCount;
+    ConsensusModel::State *receiveBuffer = &m_local(receiveRow, 0);
+
+    MPI_Sendrecv(const_cast<ConsensusModel::State*>(sendBuffer), static_cast<int>(m_colCount), MPI_UNSIGNED_CHAR, destination, 0,
+                 receiveBuffer, static_cast<int>(m_colCount), MPI_UNSIGNED_CHAR, source, 0,
+                 m_communicator, MPI_STATUS_IGNORE);
+}
+
+void DistributedConsensusArray::updateRows(std::default_random_engine &generator, long long firstRow, long long rowCount)
+{
+    std::uniform_int_distribution<long long> rowDistribution(firstRow, firstRow + rowCount - 1);
+    std::uniform_int_distribution<long long> colDistribution(0, m_colCount - 1);
+
+    long long updates = rowCount * m_colCount;
+    for(long long i = 0; i < updates; ++i)
+    {
+        long long row = rowDistribution(generator);
+        long long col = colDistribution(generator);
+        m_local.update(generator, row, col);
+    }
+}
+
+void DistributedConsensusArray::sweep(std::default_random_engine &generator)
+{
+    int above = (m_rank + m_rankCount - 1) % m_rankCount;
+    int below = (m_rank + 1) % m_rankCount;
+
+    long long topRows = m_localRows / 2;
+    long long bottomRows = m_localRows - topRows;
+
+    // Top half: fetch the last row of the rank above into the upper halo, update, then hand the
+    // halo back so invasions across the boundary land in the owner's cells.
+    exchangeRow(m_localRows, below, 0, above);
+    updateRows(generator, 1, topRows);
+    exchangeRow(0, above, m_localRows, below);
+
+    // Bottom half: the same with the first row of the rank below and the lower halo.
+    exchangeRow(1, above, m_localRows + 1, below);
+    updateRows(generator, topRows + 1, bottomRows);
+    exchangeRow(m_localRows + 1, below, 1, above);
+}
+
+void DistributedConsensusArray::localCounts(long long counts[MAXSTATE]) const
+{
+    for(int state = 0; state < MAXSTATE; ++state)
+    {
+        counts[state] = 0;
+    }
+
+    // Only the owned rows count, the halos are copies of other ranks' cells.
+    const ConsensusModel::State *first = m_local.getStorage().data() + m_colCount;
+    const ConsensusModel::State *last = first + m_localRows * m_colCount;
+    for(const ConsensusModel::State *cell = first; cell != last; ++cell)
+    {
+        ++counts[*cell];
+    }
+}
+
+void DistributedConsensusArray::globalCounts(long long counts[MAXSTATE]) const
+{
+    long long local[MAXSTATE];
+    localCounts(local);
+    MPI_Allreduce(local, counts, MAXSTATE, MPI_LONG_LONG, MPI_SUM, m_communicator);
+}
+
+long long DistributedConsensusArray::stateCount(ConsensusModel::State state) const
+{
+    long long counts[MAXSTATE];
+    globalCounts(counts);
+    return counts[state];
+}
+
+double DistributedConsensusArray::interfaceDensity()
+{
+    // The down neighbours of the last owned row are the first row of the rank below.
+    int above = (m_rank + m_rankCount - 1) % m_rankCount;
+    int below = (m_rank + 1) % m_rankCount;
+    exchangeRow(1, above, m_localRows + 1, below);
+
+    const ConsensusModel::State *cells = m_local.getStorage().data();
+    long long local = 0;
+    for(long long row = 1; row <= m_localRows; ++row)
+    {
+        const ConsensusModel::State *current = cells + row * m_colCount;
+        const ConsensusModel::State *next = current + m_colCount;
+        for(long long col = 0; col < m_colCount; ++col)
+        {
+            local += (current[col] != current[(col + 1) % m_colCount]);
+            local += (current[col] != next[col]);
+        }
+    }
+
+    long long unlike = 0;
+    MPI_Allreduce(&local, &unlike, 1, MPI_LONG_LONG, MPI_SUM, m_communicator);
+    return static_cast<double>(unlike) / (2 * getSize());
+}
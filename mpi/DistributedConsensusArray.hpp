@@ -0,0 +1,145 @@
+#ifndef DistributedConsensusArray_hpp
+#define DistributedConsensusArray_hpp
+
+#include <mpi.h> // For communicating between ranks.
+#include <random> // For generating random numbers.
+#include "ConsensusArray.hpp"
+
+/**
+ * \file
+ * \class DistributedConsensusArray
+ * \brief Class to model a 2D periodic lattice split into strips of rows across MPI ranks.
+ *
+ * Each rank owns a contiguous strip of rows, held in a local ConsensusArray with one halo row
+ * above and one below. Because an update copies a cell into its neighbour, a rank's updates can
+ * write into a halo row, i.e. into another rank's cells. A sweep is therefore done in two phases:
+ * first every rank updates the top half of its strip, whose only foreign neighbour is the last
+ * row of the rank above, then the bottom half, whose only foreign neighbour is the first row of
+ * the rank below. Before a phase the foreign row is copied into the halo and afterwards the halo,
+ * with any invasions into it, is sent back to its owner. The owner never touches that row during
+ * the phase, so the result is the same random-sequential process with the update order only
+ * shuffled between halves of strips.
+ *
+ * stateCount() and everything built on it (stateFraction(), isAbsorbed()) reduce over all ranks,
+ * so they are collective and must be called by every rank.
+ */
+class DistributedConsensusArray : public ConsensusModel
+{
+private:
+    /// Member variable that holds the communicator the lattice is split over.
+    MPI_Comm m_communicator;
+
+    /// Member variable that holds this rank.
+    int m_rank;
+
+    /// Member variable that holds the number of ranks.
+    int m_rankCount;
+
+    /// Member variable that holds the number of rows in the whole lattice.
+    long long m_globalRows;
+
+    /// Member variable that holds the number of columns.
+    long long m_colCount;
+
+    /// Member variable that holds the first global row owned by this rank.
+    long long m_firstRow;
+
+    /// Member variable that holds the number of rows owned by this rank.
+    long long m_localRows;
+
+    /// Member variable that holds the owned rows in local rows 1..m_localRows plus two halo rows.
+    ConsensusArray m_local;
+
+    /**
+     *\brief Copies a local row into a neighbouring rank's local row.
+     *\param sendRow local row sent to the destination.
+     *\param destination rank that receives it.
+     *\param receiveRow local row overwritten by what the source sends.
+     *\param source rank that sends to this one.
+     */
+    void exchangeRow(long long sendRow, int destination, long long receiveRow, int source);
+
+    /**
+     *\brief Performs random updates of cells in a range of local rows.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param firstRow first local row of the range.
+     *\param rowCount number of rows in the range.
+     */
+    void updateRows(std::default_random_engine &generator, long long firstRow, long long rowCount);
+
+    /**
+     *\brief Counts the cells in each state owned by this rank.
+     *\param counts array filled with the number of cells in each state.
+     */
+    void localCounts(long long counts[MAXSTATE]) const;
+
+public:
+    /**
+     *\brief Constructor that splits the rows between ranks and randomises each strip.
+     *
+     * Every rank must have at least four rows.
+     *
+     *\param generator std::default_random_engine reference for random number generation, should be seeded differently on each rank.
+     *\param communicator MPI communicator to split the lattice over.
+     *\param rows number of rows in the whole lattice.
+     *\param cols number of columns in the lattice.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     */
+    DistributedConsensusArray(
+        std::default_random_engine &generator,
+        MPI_Comm communicator,
+        long long rows = 50,
+        long long cols = 50,
+        double prob1 = 1.0,
+        double prob2 = 1.0
+        );
+
+    /**
+     *\brief Getter for the first global row owned by this rank.
+     *\return Integer value representing the row.
+     */
+    long long getFirstRow() const;
+
+    /**
+     *\brief Getter for the number of rows owned by this rank.
+     *\return Integer value representing the number of rows.
+     */
+    long long getLocalRows() const;
+
+    /**
+     *\brief Getter for the number of sites in the whole lattice.
+     *\return Integer value representing the size of the lattice.
+     */
+    long long getSize() const override;
+
+    /**
+     *\brief Collective count of the cells in a given state over the whole lattice.
+     *\param state value representing the state of interest.
+     *\return Integer value representing the number of cells in the state of interest.
+     */
+    long long stateCount(State state) const override;
+
+    /**
+     *\brief Collective count of the cells in every state with a single reduction.
+     *\param counts array filled with the number of cells in each state.
+     */
+    void globalCounts(long long counts[MAXSTATE]) const;
+
+    /**
+     *\brief Collective density of unlike neighbour pairs over the whole lattice.
+     *
+     * Refreshes the lower halo from the rank below, so it must be called by every rank between sweeps.
+     *
+     *\return fraction of the right and down neighbour pairs holding different states.
+     */
+    double interfaceDensity();
+
+    /**
+     *\brief Collective sweep of the whole lattice, i.e. on average one update per cell.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweep(std::default_random_engine &generator) override;
+};
+
+#endif /* DistributedConsensusArray_hpp */
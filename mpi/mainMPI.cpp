@@ -0,0 +1,204 @@
+#include "DistributedConsensusArray.hpp"
+#include "getTimeStamp.hpp"
+#include "makeDirectory.hpp"
+#include "ConsensusInputParameters.hpp"
+#include "ConsensusResults.hpp"
+#include "Timer.hpp"
+#include <mpi.h>
+#include <random>
+#include <iostream>
+#include <chrono>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <memory>
+
+int main(int argc, char *argv[])
+{
+/*************************************************************************************************************************
+************************************************* Preparations **********************************************************
+*************************************************************************************************************************/
+
+    MPI_Init(&argc, &argv);
+
+    int rank;
+    int rankCount;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &rankCount);
+
+    // Start the clock so execution time can be calculated.
+    Timer timer;
+
+    // Input parameters.
+    long long rowCount;
+    long long colCount;
+    double p_1;
+    double p_2;
+    int totalSweeps;
+    unsigned int seed;
+    std::string outputName;
+
+    // Set up optional command line arguments.
+    boost::program_options::options_description desc("Options for distributed Consensus simulation");
+
+    // Add all optional command line arguments.
+    desc.add_options()
+
+        ("row-count,r", boost::program_options::value<long long>(&rowCount)->default_value(50), "The number of rows in the lattice, split between the ranks.")
+        ("column-count,c", boost::program_options::value<long long>(&colCount)->default_value(50), "The number of columns in the lattice.")
+        ("p_1,p", boost::program_options::value<double>(&p_1)->default_value(1), "Value of p_1 in simulation.")
+        ("p_2,q", boost::program_options::value<double>(&p_2)->default_value(1), "Value of p_2 in simulation.")
+        ("sweeps,s", boost::program_options::value<int>(&totalSweeps)->default_value(10000), "The number of sweeps in the simulation.")
+        ("seed", boost::program_options::value<unsigned int>(&seed)->default_value(0), "Seed of the random number generators, 0 seeds from the clock.")
+        ("output,o",boost::program_options::value<std::string>(&outputName)->default_value(getTimeStamp()), "Name of output directory to save output files into.")
+        ("stop-at-consensus", "Stop as soon as a measurement finds the lattice in an absorbing state.")
+        ("help,h", "Produce help message");
+
+    // Make arguments available to program.
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc,argv,desc), vm);
+    boost::program_options::notify(vm);
+
+    // If the user asks for help display it then exit.
+    if(vm.count("help"))
+    {
+        if(0 == rank)
+        {
+            std::cout << desc << '\n';
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Every rank must use the same base seed and output name, so take rank 0's.
+    if(0 == seed && 0 == rank)
+    {
+        seed = static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+    int outputNameLength = static_cast<int>(outputName.size());
+    MPI_Bcast(&outputNameLength, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    outputName.resize(outputNameLength);
+    MPI_Bcast(&outputName[0], outputNameLength, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    // Give each rank an independent stream derived from the shared seed.
+    std::seed_seq seedSequence{seed, static_cast<unsigned int>(rank)};
+    std::default_random_engine generator(seedSequence);
+
+    // Every rank sees the same sizes, so they all stop here together rather than one throwing while
+    // the others wait for it in the halo exchange.
+    if(rowCount < 4LL * rankCount || colCount < 1)
+    {
+        if(0 == rank)
+        {
+            std::cerr << "Every rank needs at least four rows of the lattice: use at least " << 4LL * rankCount << " rows.\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Create the distributed lattice that will be used in the simulation. Any other failure on one
+    // rank would leave the rest blocked, so it takes the whole job down.
+    std::unique_ptr<DistributedConsensusArray> distributedLattice;
+    try
+    {
+        distributedLattice.reset(new DistributedConsensusArray(generator, MPI_COMM_WORLD, rowCount, colCount, p_1, p_2));
+    }
+    catch(const std::exception &error)
+    {
+        std::cerr << "Rank " << rank << ": " << error.what() << '\n';
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    DistributedConsensusArray &lattice = *distributedLattice;
+
+    // Only rank 0 writes output.
+    std::fstream fractionsOutput;
+    std::fstream resultsOutput;
+
+    if(0 == rank)
+    {
+        makeDirectory(outputName);
+        fractionsOutput.open(outputName+"/Fractions.dat", std::ios::out);
+        resultsOutput.open(outputName+"/Results.txt", std::ios::out);
+        std::fstream inputParametersOutput(outputName+"/Input.txt", std::ios::out);
+
+        ConsensusInputParameters inputParameters
+        {
+          rowCount,
+          colCount,
+          p_1,
+          p_2,
+          totalSweeps,
+          outputName,
+          "distributed(ranks=" + std::to_string(rankCount) + ")",
+          lattice.getSize()
+        };
+
+        std::cout << inputParameters << '\n';
+        inputParametersOutput << inputParameters << '\n';
+    }
+
+/*************************************************************************************************************************
+************************************************* Main Loop *************************************************************
+*************************************************************************************************************************/
+
+   long long counts[ConsensusModel::MAXSTATE];
+   bool stopAtConsensus = vm.count("stop-at-consensus");
+
+   for(int sweep = 0; sweep < totalSweeps; ++sweep )
+   {
+      lattice.sweep(generator);
+
+      // If we are on a measurement sweep then reduce the counts over all ranks.
+      if((0 == sweep%10))
+      {
+        lattice.globalCounts(counts);
+        double size = static_cast<double>(lattice.getSize());
+
+        if(0 == rank)
+        {
+          fractionsOutput << sweep << ' ' << counts[ConsensusModel::Red]/size << ' '
+            << counts[ConsensusModel::Green]/size << ' ' << counts[ConsensusModel::Blue]/size << '\n';
+        }
+
+        // Every rank sees the same reduced counts so they all leave the loop together.
+        bool absorbed = (counts[ConsensusModel::Red] == lattice.getSize())
+          || (counts[ConsensusModel::Green] == lattice.getSize())
+          || (counts[ConsensusModel::Blue] == lattice.getSize());
+        if(stopAtConsensus && absorbed)
+        {
+          break;
+        }
+      }
+   }
+
+/*************************************************************************************************************************
+******************************************** Output/Clean Up *************************************************************
+**************************************************************************************************************************/
+
+   // At the end of the simulation check to see whether the simulation has reached an abosorbing state.
+   bool hasReachedAbsorbingState = lattice.isAbsorbed();
+
+   if(0 == rank)
+   {
+     ConsensusResults results
+     {
+       hasReachedAbsorbingState
+     };
+
+     // Output results to file.
+     resultsOutput << results << '\n';
+
+     // Output results to command line.
+     std::cout << results << '\n';
+
+     // Report how long the program took to execute.
+     std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time take to execute(s) =    " <<
+     std::right << timer.elapsed() << '\n';
+   }
+
+   MPI_Finalize();
+   return 0;
+}
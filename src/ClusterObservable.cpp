@@ -0,0 +1,73 @@
+#include "ClusterObservable.hpp"
+#include <algorithm>
+
+namespace
+{
+	/// Finds the root of a site's cluster, halving the path on the way.
+	long long findRoot(std::vector<long long> &parents, long long site)
+	{
+		while(parents[site] != site)
+		{
+			parents[site] = parents[parents[site]];
+			site = parents[site];
+		}
+		return site;
+	}
+
+	/// Joins the clusters of two sites.
+	void join(std::vector<long long> &parents, long long first, long long second)
+	{
+		first  = findRoot(parents, first);
+		second = findRoot(parents, second);
+		if(first != second)
+		{
+			parents[std::max(first, second)] = std::min(first, second);
+		}
+	}
+}
+
+std::vector<double> ClusterObservable::measure(const ConsensusArray &lattice) const
+{
+	long long rows = lattice.getRows();
+	long long cols = lattice.getCols();
+	const ConsensusModel::State *cells = lattice.getStorage().data();
+
+	// Sites are numbered in row major order whatever the storage layout.
+	std::vector<long long> parents(static_cast<std::size_t>(rows * cols));
+	for(long long site = 0; site < rows * cols; ++site)
+	{
+		parents[site] = site;
+	}
+
+	for(long long row = 0; row < rows; ++row)
+	{
+		long long down = (row + 1 == rows) ? 0 : row + 1;
+		for(long long col = 0; col < cols; ++col)
+		{
+			long long right = (col + 1 == cols) ? 0 : col + 1;
+			ConsensusModel::State state = cells[lattice.index(row, col)];
+
+			if(cells[lattice.index(row, right)] == state)
+			{
+				join(parents, row * cols + col, row * cols + right);
+			}
+			if(cells[lattice.index(down, col)] == state)
+			{
+				join(parents, row * cols + col, down * cols + col);
+			}
+		}
+	}
+
+	// Count each cluster at its root.
+	std::vector<long long> sizes(parents.size(), 0);
+	long long clusterCount = 0;
+	long long largest = 0;
+	for(long long site = 0; site < rows * cols; ++site)
+	{
+		long long size = ++sizes[findRoot(parents, site)];
+		clusterCount += (1 == size);
+		largest = std::max(largest, size);
+	}
+
+	return {static_cast<double>(clusterCount), static_cast<double>(largest) / (rows * cols)};
+}
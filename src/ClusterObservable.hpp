@@ -0,0 +1,26 @@
+#ifndef ClusterObservable_hpp
+#define ClusterObservable_hpp
+
+#include "MeasurementExecutor.hpp"
+
+/**
+ *\file
+ *\class ClusterObservable
+ *\brief Observable giving the number of clusters of like sites and the largest cluster as a fraction of the lattice.
+ *
+ * Sites belong to the same cluster when they are nearest neighbours, including across the periodic
+ * boundaries, and hold the same state. Clusters are found by union-find with path halving in one
+ * row major pass over the lattice.
+ */
+class ClusterObservable : public MeasurementExecutor::IObservable
+{
+public:
+	/**
+	 *\brief Finds the clusters of the lattice.
+	 *\param lattice snapshot of the lattice.
+	 *\return the number of clusters and the size of the largest as a fraction of the lattice.
+	 */
+	std::vector<double> measure(const ConsensusArray &lattice) const override;
+};
+
+#endif /* ClusterObservable_hpp */
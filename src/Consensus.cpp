@@ -1,18 +1,24 @@
 #include "ConsensusArray.hpp"
+#include "LatticeInitialiser.hpp"
+#include "ParallelFor.hpp"
+#include <thread>
+#include <array>
 
 constexpr int ConsensusArray::stateSymbols[];
+const int ConsensusArray::defaultPrefetchDistance;
+constexpr int ConsensusArray::pairIndices[ConsensusArray::MAXSTATE][ConsensusArray::MAXSTATE];
 
-ConsensusArray::State& ConsensusArray::operator()(int row, int col)
+ConsensusArray::State& ConsensusArray::operator()(long long row, long long col)
 {
     // Take into account periodic boundary conditions.
     row = (row + m_rowCount) % m_rowCount;
     col = (col + m_colCount) % m_colCount;
 
     // Return 1D index of 1D array corresponding to the 2D index.
-    return m_boardData[col + row * m_colCount];
+    return m_boardData[index(row, col)];
 }
 
-const ConsensusArray::State& ConsensusArray::operator()(int row, int col) const
+const ConsensusArray::State& ConsensusArray::operator()(long long row, long long col) const
 {
     // Take into account periodic boundary conditions we add extra m_rowCount and m_colCount
     // terms here to take into account the fact that the caller may be indexing with -1.
@@ -20,210 +26,356 @@ const ConsensusArray::State& ConsensusArray::operator()(int row, int col) const
     col = (col + m_colCount) % m_colCount;
 
     // Return 1D index of 1D array corresponding to the 2D index.
-    return m_boardData[col + row * m_colCount];
+    return m_boardData[index(row, col)];
 }
 
 
 ConsensusArray::ConsensusArray(
-	int rows,
-	int cols,
+	long long rows,
+	long long cols,
 	double prob1,
 	double prob2,
-	ConsensusArray::State state
-	) : m_rowCount{rows},
+	ConsensusArray::State state,
+	ConsensusArray::Layout layout,
+	int tileSize
+	) : ConsensusModel(prob1, prob2),
+		m_rowCount{rows},
 		m_colCount{cols},
-		m_p_1{prob1},
-		m_p_2{prob2},
-		m_boardData(rows*cols, state)
+		m_boardData(rows*cols)
 {
+    setLayout(layout, tileSize);
 
+    // Fill in the same contiguous chunks as the parallel initialiser, so each chunk's pages are
+    // first touched, and placed, by the thread that owns them.
+    State *cells = m_boardData.data();
+    parallelFor(static_cast<int>(std::max(1u, std::thread::hardware_concurrency())), getSize(), 1LL << 18,
+        [cells, state](int, long long begin, long long end) { std::fill(cells + begin, cells + end, state); });
+
+    recount();
 }
 
 ConsensusArray::ConsensusArray(
 	std::default_random_engine &generator,
-	int rows,
-	int cols,
+	long long rows,
+	long long cols,
 	double prob1,
-	double prob2
-	) : m_rowCount{rows},
+	double prob2,
+	ConsensusArray::Layout layout,
+	int tileSize
+	) : ConsensusModel(prob1, prob2),
+		m_rowCount{rows},
 		m_colCount{cols},
-		m_p_1{prob1},
-		m_p_2{prob2}
+		m_boardData(rows*cols)
 {
-    //TODO: This can probably be made more efficient.
+    setLayout(layout, tileSize);
+
+    // Fill the cells in parallel, this is also the first touch of the freshly allocated storage.
+    randomise(generator);
 
-    // Reserve the correct amount of space in the board data.
-    m_boardData.reserve(rows * cols);
+}
 
-    // Create a distribution to sample from the states, we -2 since we are ignoring the immune cells
-    // and the parameter is a closed interval.
-    static std::uniform_int_distribution<int> distribution(0,static_cast<int>(ConsensusArray::MAXSTATE)-1);
-    for(int i = 0; i < rows*cols; ++i)
+ConsensusArray::ConsensusArray(
+	LatticeStorage &&storage,
+	long long rows,
+	long long cols,
+	double prob1,
+	double prob2,
+	ConsensusArray::Layout layout,
+	int tileSize
+	) : ConsensusModel(prob1, prob2),
+		m_rowCount{rows},
+		m_colCount{cols},
+		m_boardData(std::move(storage))
+{
+    if(m_boardData.size() != rows * cols)
     {
-        m_boardData.push_back(static_cast<ConsensusArray::State>(distribution(generator)));
+        throw std::invalid_argument("Lattice storage does not hold rows*cols cells.");
     }
 
+    setLayout(layout, tileSize);
+
+    // Tiles are visited in a random order so read-ahead of a mapped file would be wasted.
+    m_boardData.adviseAccess(ConsensusArray::RowMajor == layout);
 }
 
 void ConsensusArray::randomise(std::default_random_engine &generator)
 {
-    // Create a uniform distribution for the states on the board.
-    static std::uniform_int_distribution<int> distribution(0,static_cast<int>(ConsensusArray::MAXSTATE)-1);
-
-    for(auto &cell : m_boardData)
-    {
-        cell = static_cast<ConsensusArray::State>(distribution(generator));
-    }
+    // Each thread draws its cells from its own part of a counter-based stream keyed from the generator.
+    LatticeInitialiser(generator).random(*this);
 
 }
 
 
-int ConsensusArray::getRows() const
+void ConsensusArray::setLayout(ConsensusArray::Layout layout, int tileSize)
 {
-    return m_rowCount;
+    m_layout      = layout;
+    m_tileShift   = 0;
+    m_tileMask    = 0;
+    m_tilesPerRow = m_colCount;
+
+    if(ConsensusArray::Tiled == layout)
+    {
+        while((1 << m_tileShift) < tileSize)
+        {
+            ++m_tileShift;
+        }
+
+        if((1 << m_tileShift) != tileSize || m_rowCount % tileSize != 0 || m_colCount % tileSize != 0)
+        {
+            throw std::invalid_argument("Tile size must be a power of two that divides the number of rows and columns.");
+        }
+
+        m_tileMask    = tileSize - 1;
+        m_tilesPerRow = m_colCount / tileSize;
+        m_tileOrder.resize((m_rowCount / tileSize) * m_tilesPerRow);
+    }
 }
 
-int ConsensusArray::getCols() const
+ConsensusArray::Layout ConsensusArray::getLayout() const
 {
-    return m_colCount;
+    return m_layout;
 }
 
-int ConsensusArray::getSize() const
+int ConsensusArray::getTileSize() const
 {
-    return m_colCount * m_rowCount;
+    return 1 << m_tileShift;
 }
 
-double ConsensusArray::getp1() const
+long long ConsensusArray::getRows() const
 {
-	return m_p_1;
+    return m_rowCount;
 }
 
-double ConsensusArray::getp2() const
+long long ConsensusArray::getCols() const
 {
-	return m_p_2;
+    return m_colCount;
 }
 
-
-void ConsensusArray::setp1(double prob)
+const LatticeStorage& ConsensusArray::getStorage() const
 {
-	m_p_1 = prob;
+    return m_boardData;
 }
 
-void ConsensusArray::setp2(double prob)
+LatticeStorage& ConsensusArray::getStorage()
 {
-	m_p_2 = prob;
+    return m_boardData;
 }
 
-
-
+long long ConsensusArray::getSize() const
+{
+    return m_colCount * m_rowCount;
+}
 
 ConsensusArray::State ConsensusArray::update(std::default_random_engine& generator)
 {
 	// Create a uniform distribution for the rows and columns remembering to subtract 1 for the closed limits.
-	std::uniform_int_distribution<int> rowDistribution(0,m_rowCount-1);
-	std::uniform_int_distribution<int> colDistribution(0,m_colCount-1);
-
-  int row = rowDistribution(generator);
-  int col = colDistribution(generator);
+	std::uniform_int_distribution<long long> rowDistribution(0,m_rowCount-1);
+	std::uniform_int_distribution<long long> colDistribution(0,m_colCount-1);
 
-  int neighbourRow;
-  int neighbourCol;
+  long long row = rowDistribution(generator);
+  long long col = colDistribution(generator);
 
+  return update(generator, row, col);
+}
 
+ConsensusArray::State ConsensusArray::update(std::default_random_engine& generator, long long row, long long col)
+{
   // Create distriubtion for randomly selecting neighbour.
   static std::uniform_int_distribution<int> neighbourDistribution(0,3);
 
   // Generate an index for the neighbour.
-  int neighbour = neighbourDistribution(generator);
-
-  // Use four values to select one of 4 possible neighbours.
-  switch (neighbour) {
-    case 0:
-      neighbourRow = row;
-      neighbourCol = col + 1;
-      break;
-
-    case 1:
-      neighbourRow = row + 1;
-      neighbourCol = col;
-      break;
-
-    case 2:
-      neighbourRow = row;
-      neighbourCol = col - 1;
-      break;
-
-    case 3:
-      neighbourRow = row - 1;
-      neighbourCol = col;
-  }
+  long long neighbourRow = row;
+  long long neighbourCol = col;
+  moveToNeighbour(neighbourRow, neighbourCol, neighbourDistribution(generator));
 
   // Create a distribution between 0 and 1 for accepting or rejecting an update.
   static std::uniform_real_distribution<double> distribution(0.0,1.0);
 
-  // update the neighbour with a probability determined by the type of update.
-  double updateProb = getProbability((*this)(row,col),(*this)(neighbourRow, neighbourCol));
+  return attemptInvasion(row, col, neighbourRow, neighbourCol, distribution(generator));
+}
 
-  if(distribution(generator) < updateProb)
+inline ConsensusArray::State ConsensusArray::attemptInvasion(long long row, long long col, long long neighbourRow, long long neighbourCol, double uniform)
+{
+  long long neighbour = index(neighbourRow, neighbourCol);
+  ConsensusArray::State site = m_boardData[index(row, col)];
+  ConsensusArray::State target = m_boardData[neighbour];
+
+  // update the neighbour with a probability determined by the type of update.
+  if(uniform < getProbability(site, target))
   {
-    (*this)(neighbourRow, neighbourCol) = (*this)(row,col);
+    changeState(neighbourRow, neighbourCol, neighbour, site);
   }
-  else
-  {
 
-  }
   // Return the updated state, even if it is the same as it was originally.
-  return (*this)(row,col);
+  return site;
+}
 
+long long ConsensusArray::stateCount(ConsensusArray::State state) const
+{
+	return m_stateCounts[state];
+}
 
+long long ConsensusArray::bondCount(ConsensusArray::State first, ConsensusArray::State second) const
+{
+	return m_bondCounts[pairIndices[first][second]];
 }
 
-double ConsensusArray::getProbability(ConsensusArray::State state1, ConsensusArray::State state2) const
+long long ConsensusArray::unlikeBondCount() const
 {
-  if((state1==ConsensusArray::Red && state2==ConsensusArray::Green)
-      || (state1==ConsensusArray::Green && state2 == ConsensusArray::Blue)
-      || (state1==ConsensusArray::Blue && state2 == ConsensusArray::Red))
-      {
-        return m_p_1;
-      }
-  else if((state1==ConsensusArray::Green && state2==ConsensusArray::Red)
-      || (state1==ConsensusArray::Blue && state2 == ConsensusArray::Green)
-      || (state1==ConsensusArray::Red && state2 == ConsensusArray::Blue))
-      {
-        return m_p_2;
-      }
-  else
-  {
-    return 0;
-  }
+	return m_unlikeBonds;
+}
+
+long long ConsensusArray::totalBondCount() const
+{
+	return m_totalBonds;
 }
 
-int ConsensusArray::stateCount(ConsensusArray::State state) const
+double ConsensusArray::interfaceDensity() const
 {
-	double total = 0;
-	for(const auto& cellState : m_boardData)
+	return m_totalBonds > 0 ? static_cast<double>(m_unlikeBonds) / m_totalBonds : 0;
+}
+
+void ConsensusArray::recount()
+{
+	int threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::array<long long, MAXSTATE + MAXSTATE * (MAXSTATE + 1) / 2>> partialCounts(static_cast<std::size_t>(threadCount));
+
+	// Each cell counts itself and its bonds to the right and below, so every bond is counted once.
+	parallelFor(threadCount, m_rowCount, std::max(1LL, (1LL << 16) / std::max(1LL, m_colCount)),
+		[this, &partialCounts](int thread, long long firstRow, long long lastRow) {
+			std::array<long long, MAXSTATE + MAXSTATE * (MAXSTATE + 1) / 2> counts{};
+			for(long long row = firstRow; row < lastRow; ++row)
+			{
+				long long down = (row + 1 == m_rowCount) ? 0 : row + 1;
+				for(long long col = 0; col < m_colCount; ++col)
+				{
+					long long right = (col + 1 == m_colCount) ? 0 : col + 1;
+					ConsensusArray::State state = m_boardData[index(row, col)];
+					++counts[state];
+					if(right != col)
+					{
+						++counts[MAXSTATE + pairIndices[state][m_boardData[index(row, right)]]];
+					}
+					if(down != row)
+					{
+						++counts[MAXSTATE + pairIndices[state][m_boardData[index(down, col)]]];
+					}
+				}
+			}
+			partialCounts[thread] = counts;
+		});
+
+	long long stateCounts[MAXSTATE] = {};
+	long long bondCounts[MAXSTATE * (MAXSTATE + 1) / 2] = {};
+	for(const auto &counts : partialCounts)
 	{
-		if(state == cellState)
+		for(int state = 0; state < MAXSTATE; ++state)
+		{
+			stateCounts[state] += counts[state];
+		}
+		for(int pair = 0; pair < MAXSTATE * (MAXSTATE + 1) / 2; ++pair)
 		{
-			total++;
+			bondCounts[pair] += counts[MAXSTATE + pair];
 		}
 	}
 
-	return total;
+	setCounts(stateCounts, bondCounts);
 }
 
-double ConsensusArray::stateFraction(ConsensusArray::State state) const
+void ConsensusArray::setCounts(const long long stateCounts[MAXSTATE], const long long bondCounts[MAXSTATE * (MAXSTATE + 1) / 2])
 {
-	double total = 0;
-	for(const auto& cellState : m_boardData)
+	std::copy(stateCounts, stateCounts + MAXSTATE, m_stateCounts);
+	std::copy(bondCounts, bondCounts + MAXSTATE * (MAXSTATE + 1) / 2, m_bondCounts);
+
+	m_totalBonds = 0;
+	m_unlikeBonds = 0;
+	for(int first = 0; first < MAXSTATE; ++first)
 	{
-		if(state == cellState)
+		for(int second = first; second < MAXSTATE; ++second)
 		{
-			total++;
+			long long bonds = m_bondCounts[pairIndices[first][second]];
+			m_totalBonds += bonds;
+			m_unlikeBonds += (first != second) ? bonds : 0;
 		}
 	}
+}
 
-	return total/(m_colCount*m_rowCount);
+void ConsensusArray::sweep(std::default_random_engine& generator)
+{
+	if(ConsensusArray::RowMajor == m_layout && m_prefetchDistance > 0)
+	{
+		sweepPipelined(generator);
+		return;
+	}
+
+	sweepSchedule(generator, [this, &generator](long long row, long long col) { update(generator, row, col); });
+}
+
+void ConsensusArray::sweepPipelined(std::default_random_engine& generator)
+{
+	// The same distributions as sweepSchedule() and update(), drawn in the same order.
+	std::uniform_int_distribution<long long> rowDistribution(0, m_rowCount - 1);
+	std::uniform_int_distribution<long long> colDistribution(0, m_colCount - 1);
+	std::uniform_int_distribution<int> neighbourDistribution(0,3);
+	std::uniform_real_distribution<double> distribution(0.0,1.0);
+
+	const ConsensusArray::State *cells = m_boardData.data();
+	long long mask = static_cast<long long>(m_pipeline.size()) - 1;
+
+	// None of an update's random numbers depend on the lattice, so they can be drawn before the
+	// updates in front of it are done. Its cells are prefetched then, and by the time it is done they
+	// have arrived. The target is written and changeState() reads the target's neighbours above and
+	// below, which are the only other cache lines an update touches.
+	auto draw = [&](PendingUpdate &pending) {
+		pending.row = rowDistribution(generator);
+		pending.col = colDistribution(generator);
+		pending.neighbourRow = pending.row;
+		pending.neighbourCol = pending.col;
+		moveToNeighbour(pending.neighbourRow, pending.neighbourCol, neighbourDistribution(generator));
+		pending.uniform = distribution(generator);
+
+		long long above = (0 == pending.neighbourRow) ? m_rowCount - 1 : pending.neighbourRow - 1;
+		long long below = (pending.neighbourRow + 1 == m_rowCount) ? 0 : pending.neighbourRow + 1;
+		__builtin_prefetch(cells + index(pending.row, pending.col));
+		__builtin_prefetch(cells + index(pending.neighbourRow, pending.neighbourCol), 1);
+		__builtin_prefetch(cells + index(above, pending.neighbourCol));
+		__builtin_prefetch(cells + index(below, pending.neighbourCol));
+	};
+
+	long long size = getSize();
+	long long ahead = std::min<long long>(m_prefetchDistance, size);
+	for(long long i = 0; i < ahead; ++i)
+	{
+		draw(m_pipeline[i & mask]);
+	}
+
+	for(long long i = 0; i < size; ++i)
+	{
+		// The update leaves the ring before the one ahead of it takes its slot.
+		PendingUpdate pending = m_pipeline[i & mask];
+		if(i + ahead < size)
+		{
+			draw(m_pipeline[(i + ahead) & mask]);
+		}
+		attemptInvasion(pending.row, pending.col, pending.neighbourRow, pending.neighbourCol, pending.uniform);
+	}
+}
+
+void ConsensusArray::setPrefetchDistance(int distance)
+{
+	m_prefetchDistance = std::max(0, distance);
+
+	std::size_t slots = 1;
+	while(slots < static_cast<std::size_t>(m_prefetchDistance))
+	{
+		slots *= 2;
+	}
+	m_pipeline.resize(slots);
+}
+
+int ConsensusArray::getPrefetchDistance() const
+{
+	return m_prefetchDistance;
 }
 
 
@@ -232,12 +384,12 @@ std::ostream& operator<<(std::ostream& out, const ConsensusArray &board)
 {
 
 
-    int maxRows = board.getRows();
-    int maxCols = board.getCols();
+    long long maxRows = board.getRows();
+    long long maxCols = board.getCols();
 
-    for(int row = 0; row < maxRows; ++row)
+    for(long long row = 0; row < maxRows; ++row)
     {
-        for(int col = 0; col < maxCols; ++ col)
+        for(long long col = 0; col < maxCols; ++ col)
         {
             out << ConsensusArray::stateSymbols[board(row,col)] << ' ';
         }
@@ -0,0 +1,359 @@
+#include "ConsensusApi.h"
+#include "ConsensusArray.hpp"
+#include "SynchronousConsensusArray.hpp"
+#include "LatticeInitialiser.hpp"
+#include "ClusterObservable.hpp"
+#include "CorrelationObservable.hpp"
+#include "DataArray.hpp"
+#include <random>
+#include <memory>
+#include <string>
+#include <new>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+
+/**
+ *\brief State behind a consensus_simulation handle.
+ */
+struct consensus_simulation
+{
+	/// Member variable that holds the generator every random number of the simulation is drawn from.
+	std::default_random_engine generator;
+
+	/// Member variable that holds the lattice.
+	std::unique_ptr<ConsensusArray> lattice;
+
+	/// Member variable that holds the threads used to initialise the lattice.
+	int threads;
+
+	/// Member variable that holds the sweeps run since the lattice was initialised.
+	long long sweeps;
+
+	/// Member variable that holds the measured fractions of each species.
+	DataArray fractions[ConsensusModel::MAXSTATE];
+};
+
+namespace
+{
+	/// Message of the most recent failure on each thread.
+	thread_local std::string lastError;
+
+	/// Records a failure and returns its status.
+	int fail(int status, const std::string &message)
+	{
+		lastError = message;
+		return status;
+	}
+
+	/// Runs body, turning any exception into a status so that none crosses the C interface.
+	template<typename Body>
+	long long protect(Body body)
+	{
+		try
+		{
+			return body();
+		}
+		catch(const std::invalid_argument &error)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, error.what());
+		}
+		catch(const std::bad_alloc &)
+		{
+			return fail(CONSENSUS_OUT_OF_MEMORY, "Out of memory.");
+		}
+		catch(const std::exception &error)
+		{
+			return fail(CONSENSUS_ERROR, error.what());
+		}
+		catch(...)
+		{
+			return fail(CONSENSUS_ERROR, "Unknown error.");
+		}
+	}
+
+	/// Runs body on a simulation, failing if the handle is NULL.
+	template<typename Body>
+	long long guard(const consensus_simulation *simulation, Body body)
+	{
+		if(!simulation)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "The simulation is NULL.");
+		}
+		return protect(body);
+	}
+
+	/// Whether both are probabilities, false for NaN.
+	bool validRates(double p1, double p2)
+	{
+		return p1 >= 0 && p1 <= 1 && p2 >= 0 && p2 <= 1;
+	}
+
+	/// Forgets the sweeps and measurements of the previous lattice.
+	void resetStatistics(consensus_simulation &simulation)
+	{
+		simulation.sweeps = 0;
+		for(DataArray &fractions : simulation.fractions)
+		{
+			fractions = DataArray();
+		}
+	}
+}
+
+int consensus_api_version(void)
+{
+	return CONSENSUS_API_VERSION;
+}
+
+const char* consensus_last_error(void)
+{
+	return lastError.c_str();
+}
+
+consensus_simulation* consensus_create(long long rows, long long cols, double p1, double p2, int engine, int tile_size, int threads)
+{
+	if(rows < 1 || cols < 1 || engine < CONSENSUS_ROW_MAJOR || engine > CONSENSUS_SYNCHRONOUS)
+	{
+		fail(CONSENSUS_INVALID_ARGUMENT, "The lattice needs at least one row and column and a known engine.");
+		return nullptr;
+	}
+	if(!validRates(p1, p2))
+	{
+		fail(CONSENSUS_INVALID_ARGUMENT, "The invasion probabilities must lie in [0, 1].");
+		return nullptr;
+	}
+
+	std::unique_ptr<consensus_simulation> simulation;
+	long long status = protect([&]() -> long long {
+		simulation.reset(new consensus_simulation());
+		simulation->threads = threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+		resetStatistics(*simulation);
+
+		LatticeStorage storage(rows * cols);
+		if(CONSENSUS_SYNCHRONOUS == engine)
+		{
+			simulation->lattice.reset(new SynchronousConsensusArray(std::move(storage), rows, cols, p1, p2, simulation->threads));
+		}
+		else
+		{
+			ConsensusArray::Layout layout = (CONSENSUS_TILED == engine) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+			simulation->lattice.reset(new ConsensusArray(std::move(storage), rows, cols, p1, p2, layout, tile_size));
+		}
+
+		// The storage is not initialised, so start from a red lattice with counts that match it.
+		LatticeStorage &cells = simulation->lattice->getStorage();
+		std::fill(cells.data(), cells.data() + cells.size(), ConsensusModel::Red);
+		simulation->lattice->recount();
+		return CONSENSUS_OK;
+	});
+
+	return (CONSENSUS_OK == status) ? simulation.release() : nullptr;
+}
+
+void consensus_destroy(consensus_simulation *simulation)
+{
+	delete simulation;
+}
+
+int consensus_seed(consensus_simulation *simulation, uint32_t seed)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		simulation->generator.seed(seed);
+		return CONSENSUS_OK;
+	}));
+}
+
+int consensus_set_rates(consensus_simulation *simulation, double p1, double p2)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		if(!validRates(p1, p2))
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "The invasion probabilities must lie in [0, 1].");
+		}
+		simulation->lattice->setp1(p1);
+		simulation->lattice->setp2(p2);
+		return CONSENSUS_OK;
+	}));
+}
+
+int consensus_randomise(consensus_simulation *simulation, const double fractions[3])
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		LatticeInitialiser initialiser(simulation->generator, simulation->threads);
+		if(fractions)
+		{
+			if(fractions[0] < 0 || fractions[1] < 0 || fractions[2] < 0 || fractions[0] + fractions[1] + fractions[2] <= 0)
+			{
+				return fail(CONSENSUS_INVALID_ARGUMENT, "The fractions must be non-negative and not all zero.");
+			}
+			initialiser.random(*simulation->lattice, fractions);
+		}
+		else
+		{
+			initialiser.random(*simulation->lattice);
+		}
+
+		resetStatistics(*simulation);
+		return CONSENSUS_OK;
+	}));
+}
+
+long long consensus_run(consensus_simulation *simulation, long long sweeps, long long measurement_interval, int stop_at_consensus)
+{
+	return guard(simulation, [&]() -> long long {
+		if(sweeps < 0 || measurement_interval < 0)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "The sweeps and measurement interval must not be negative.");
+		}
+
+		ConsensusArray &lattice = *simulation->lattice;
+		long long sweep = 0;
+		for(; sweep < sweeps; ++sweep)
+		{
+			if(stop_at_consensus && lattice.isAbsorbed())
+			{
+				break;
+			}
+
+			lattice.sweep(simulation->generator);
+			++simulation->sweeps;
+
+			// The counts are tracked, so a measurement does not touch the lattice.
+			if(measurement_interval > 0 && 0 == simulation->sweeps % measurement_interval)
+			{
+				for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+				{
+					simulation->fractions[state].push_back(lattice.stateFraction(static_cast<ConsensusModel::State>(state)));
+				}
+			}
+		}
+		return sweep;
+	});
+}
+
+long long consensus_sweeps(const consensus_simulation *simulation)
+{
+	return guard(simulation, [&]() -> long long {
+		return simulation->sweeps;
+	});
+}
+
+int consensus_counts(const consensus_simulation *simulation, long long counts[3])
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		if(!counts)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "The counts are NULL.");
+		}
+		for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+		{
+			counts[state] = simulation->lattice->stateCount(static_cast<ConsensusModel::State>(state));
+		}
+		return CONSENSUS_OK;
+	}));
+}
+
+double consensus_interface_density(const consensus_simulation *simulation)
+{
+	double density = 0;
+	long long status = guard(simulation, [&]() -> long long {
+		density = simulation->lattice->interfaceDensity();
+		return CONSENSUS_OK;
+	});
+	return (CONSENSUS_OK == status) ? density : static_cast<double>(status);
+}
+
+int consensus_is_absorbed(const consensus_simulation *simulation)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		return simulation->lattice->isAbsorbed() ? 1 : 0;
+	}));
+}
+
+int consensus_fraction_stats(const consensus_simulation *simulation, int state, double *mean, double *error, long long *samples)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		if(state < 0 || state >= ConsensusModel::MAXSTATE)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "Unknown state.");
+		}
+
+		const DataArray &fractions = simulation->fractions[state];
+		if(mean)
+		{
+			*mean = fractions.getSize() > 0 ? fractions.mean() : 0;
+		}
+		if(error)
+		{
+			*error = fractions.getSize() > 1 ? fractions.error() : 0;
+		}
+		if(samples)
+		{
+			*samples = fractions.getSize();
+		}
+		return CONSENSUS_OK;
+	}));
+}
+
+int consensus_measure_clusters(const consensus_simulation *simulation, long long *clusters, double *largest)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		std::vector<double> measurement = ClusterObservable().measure(*simulation->lattice);
+		if(clusters)
+		{
+			*clusters = static_cast<long long>(measurement[0]);
+		}
+		if(largest)
+		{
+			*largest = measurement[1];
+		}
+		return CONSENSUS_OK;
+	}));
+}
+
+int consensus_measure_correlation(const consensus_simulation *simulation, long long max_distance, double *correlation)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		if(max_distance < 1 || !correlation)
+		{
+			return fail(CONSENSUS_INVALID_ARGUMENT, "The correlation needs a distance of at least 1 and somewhere to go.");
+		}
+
+		std::vector<double> measurement = CorrelationObservable(max_distance).measure(*simulation->lattice);
+		std::copy(measurement.begin(), measurement.end(), correlation);
+		return CONSENSUS_OK;
+	}));
+}
+
+uint8_t* consensus_lattice(consensus_simulation *simulation, long long *rows, long long *cols, int *tile_size)
+{
+	uint8_t *cells = nullptr;
+	guard(simulation, [&]() -> long long {
+		ConsensusArray &lattice = *simulation->lattice;
+		if(rows)
+		{
+			*rows = lattice.getRows();
+		}
+		if(cols)
+		{
+			*cols = lattice.getCols();
+		}
+		if(tile_size)
+		{
+			*tile_size = lattice.getTileSize();
+		}
+
+		// A cell is a one byte enumeration holding its state, so the storage is handed out as it is.
+		cells = reinterpret_cast<uint8_t*>(lattice.getStorage().data());
+		return CONSENSUS_OK;
+	});
+	return cells;
+}
+
+int consensus_recount(consensus_simulation *simulation)
+{
+	return static_cast<int>(guard(simulation, [&]() -> long long {
+		simulation->lattice->recount();
+		return CONSENSUS_OK;
+	}));
+}
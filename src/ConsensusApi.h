@@ -0,0 +1,212 @@
+#ifndef ConsensusApi_h
+#define ConsensusApi_h
+
+/**
+ *\file
+ *\brief C interface to the simulation core, for embedding it in other programs through libconsensus.so.
+ *
+ * A driver, for example Python through ctypes, creates a simulation, seeds it, initialises the
+ * lattice and runs sweeps in-process, reading the species counts, fraction statistics and the
+ * lattice itself directly, with no files written. Functions never throw: failures return NULL or a
+ * negative status, and consensus_last_error() describes the most recent failure on the calling
+ * thread. A simulation may be used by one thread at a time, different simulations by different
+ * threads at once.
+ *
+ * The interface only changes in ways that keep existing callers working; CONSENSUS_API_VERSION is
+ * increased when functions are added.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONSENSUS_API_VERSION 1
+
+#if defined(__GNUC__)
+#define CONSENSUS_API __attribute__((visibility("default")))
+#else
+#define CONSENSUS_API
+#endif
+
+/// Opaque handle to a simulation.
+typedef struct consensus_simulation consensus_simulation;
+
+/// Engines a simulation can be created with.
+enum consensus_engine
+{
+    CONSENSUS_ROW_MAJOR = 0,   /**< random sequential updates on a row major lattice */
+    CONSENSUS_TILED = 1,       /**< random sequential updates swept tile by tile */
+    CONSENSUS_SYNCHRONOUS = 2  /**< synchronous updates of a row major lattice */
+};
+
+/// Status codes, every failure is negative.
+enum consensus_status
+{
+    CONSENSUS_OK = 0,
+    CONSENSUS_INVALID_ARGUMENT = -1,
+    CONSENSUS_OUT_OF_MEMORY = -2,
+    CONSENSUS_ERROR = -3
+};
+
+/// States of a cell, as stored in the lattice.
+enum consensus_state
+{
+    CONSENSUS_RED = 0,
+    CONSENSUS_GREEN = 1,
+    CONSENSUS_BLUE = 2
+};
+
+/**
+ *\brief Version of the interface implemented by the library.
+ *\return CONSENSUS_API_VERSION of the library, which may be newer than the caller's header.
+ */
+CONSENSUS_API int consensus_api_version(void);
+
+/**
+ *\brief Describes the most recent failure on the calling thread.
+ *\return message, valid until the next call on this thread, empty if nothing has failed.
+ */
+CONSENSUS_API const char* consensus_last_error(void);
+
+/**
+ *\brief Creates a simulation of a rows x cols periodic lattice, every cell red until initialised.
+ *\param rows number of rows.
+ *\param cols number of columns.
+ *\param p1 probability of a cyclic invasion.
+ *\param p2 probability of an anti-cyclic invasion.
+ *\param engine one of consensus_engine.
+ *\param tile_size side of a tile for CONSENSUS_TILED, a power of two dividing rows and cols, ignored otherwise.
+ *\param threads threads used to initialise, and for CONSENSUS_SYNCHRONOUS to sweep, 0 uses every hardware thread.
+ *\return handle to destroy with consensus_destroy(), or NULL on failure, including probabilities outside [0, 1].
+ */
+CONSENSUS_API consensus_simulation* consensus_create(long long rows, long long cols, double p1, double p2, int engine, int tile_size, int threads);
+
+/**
+ *\brief Destroys a simulation, the lattice pointer becomes invalid. Does nothing given NULL.
+ *\param simulation handle from consensus_create().
+ */
+CONSENSUS_API void consensus_destroy(consensus_simulation *simulation);
+
+/**
+ *\brief Seeds the simulation's random number generator, a simulation is reproducible from its seed.
+ *\param simulation handle.
+ *\param seed seed of the generator.
+ *\return status.
+ */
+CONSENSUS_API int consensus_seed(consensus_simulation *simulation, uint32_t seed);
+
+/**
+ *\brief Sets the invasion probabilities used by the following sweeps.
+ *\param simulation handle.
+ *\param p1 probability of a cyclic invasion.
+ *\param p2 probability of an anti-cyclic invasion.
+ *\return status, CONSENSUS_INVALID_ARGUMENT unless both lie in [0, 1].
+ */
+CONSENSUS_API int consensus_set_rates(consensus_simulation *simulation, double p1, double p2);
+
+/**
+ *\brief Fills the lattice with independent random cells and clears the sweep count and statistics.
+ *\param simulation handle.
+ *\param fractions expected red, green and blue fractions, or NULL for equal fractions.
+ *\return status.
+ */
+CONSENSUS_API int consensus_randomise(consensus_simulation *simulation, const double fractions[3]);
+
+/**
+ *\brief Runs sweeps, adding the species fractions to the statistics every measurement_interval sweeps.
+ *\param simulation handle.
+ *\param sweeps number of sweeps to run.
+ *\param measurement_interval sweeps between measurements, 0 for no measurements.
+ *\param stop_at_consensus nonzero to stop early once a single species is left.
+ *\return number of sweeps run, or a negative status.
+ */
+CONSENSUS_API long long consensus_run(consensus_simulation *simulation, long long sweeps, long long measurement_interval, int stop_at_consensus);
+
+/**
+ *\brief Total number of sweeps run since the lattice was last initialised.
+ *\param simulation handle.
+ *\return number of sweeps, or a negative status.
+ */
+CONSENSUS_API long long consensus_sweeps(const consensus_simulation *simulation);
+
+/**
+ *\brief Reads the number of cells in each state, tracked by the lattice so this costs nothing.
+ *\param simulation handle.
+ *\param counts set to the red, green and blue counts.
+ *\return status.
+ */
+CONSENSUS_API int consensus_counts(const consensus_simulation *simulation, long long counts[3]);
+
+/**
+ *\brief Fraction of nearest neighbour bonds joining cells in different states, tracked by the lattice.
+ *\param simulation handle.
+ *\return interface density, or a negative status.
+ */
+CONSENSUS_API double consensus_interface_density(const consensus_simulation *simulation);
+
+/**
+ *\brief Whether a single species is left.
+ *\param simulation handle.
+ *\return 1 if absorbed, 0 if not, or a negative status.
+ */
+CONSENSUS_API int consensus_is_absorbed(const consensus_simulation *simulation);
+
+/**
+ *\brief Statistics of a species' fraction over the measurements since the lattice was last initialised.
+ *\param simulation handle.
+ *\param state one of consensus_state.
+ *\param mean set to the mean fraction, may be NULL.
+ *\param error set to the naive standard error of the mean, may be NULL.
+ *\param samples set to the number of measurements, may be NULL.
+ *\return status.
+ */
+CONSENSUS_API int consensus_fraction_stats(const consensus_simulation *simulation, int state, double *mean, double *error, long long *samples);
+
+/**
+ *\brief Counts the clusters of like cells, nearest neighbours across the periodic boundaries.
+ *\param simulation handle.
+ *\param clusters set to the number of clusters, may be NULL.
+ *\param largest set to the size of the largest cluster as a fraction of the lattice, may be NULL.
+ *\return status.
+ */
+CONSENSUS_API int consensus_measure_clusters(const consensus_simulation *simulation, long long *clusters, double *largest);
+
+/**
+ *\brief Measures the equal-state correlation function along the lattice axes.
+ *\param simulation handle.
+ *\param max_distance largest distance measured.
+ *\param correlation set to the correlation at distances 1 to max_distance, max_distance entries.
+ *\return status.
+ */
+CONSENSUS_API int consensus_measure_correlation(const consensus_simulation *simulation, long long max_distance, double *correlation);
+
+/**
+ *\brief Gives the cells of the lattice without copying them, one byte per cell holding a consensus_state.
+ *
+ * The cells of a row major lattice are in row major order, those of a tiled lattice are tile by
+ * tile, row major within a tile. The pointer is valid until the simulation is destroyed, except for
+ * CONSENSUS_SYNCHRONOUS, which swaps between two buffers, where it is only valid until the next run.
+ * Call consensus_recount() after writing cells through it.
+ *
+ *\param simulation handle.
+ *\param rows set to the number of rows, may be NULL.
+ *\param cols set to the number of columns, may be NULL.
+ *\param tile_size set to the side of a tile, 1 for a row major lattice, may be NULL.
+ *\return pointer to rows*cols cells, or NULL on failure.
+ */
+CONSENSUS_API uint8_t* consensus_lattice(consensus_simulation *simulation, long long *rows, long long *cols, int *tile_size);
+
+/**
+ *\brief Recounts the species and bonds after cells were written through consensus_lattice().
+ *\param simulation handle.
+ *\return status.
+ */
+CONSENSUS_API int consensus_recount(consensus_simulation *simulation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ConsensusApi_h */
@@ -6,46 +6,172 @@
 #include <iostream> // For outputting board.
 #include <utility> // For std::pair.
 #include <cmath> // For round.
+#include <stdexcept> // For reporting invalid layouts.
+#include <algorithm> // For shuffling the tile order.
+#include <numeric> // For std::iota.
+#include "ConsensusModel.hpp"
+#include "LatticeStorage.hpp"
 
 /**
  * \file
  * \brief Class to model a 2D lattice of cells in the Consensus model that can be Susceptible, Infected
  * or recovered and can move between those states stochastically.
  */
-class ConsensusArray
+class ConsensusArray : public ConsensusModel
 {
 public:
+    /// Look-up table for alive/dead cells symbols for printing.
+    static constexpr int stateSymbols[MAXSTATE] = {0,1,2};
+
+    /// Number of updates a row major sweep draws ahead of the one being done, a power of two, see setPrefetchDistance().
+    static const int defaultPrefetchDistance = 32;
+
     /**
-     * \enum State
-     * \brief Enumeration type to hold the state of the cell, dead or alive.
+     * \enum Layout
+     * \brief Enumeration type to hold how the cells are ordered in memory.
+     *
+     * RowMajor stores each row contiguously. Tiled stores square tiles of tileSize x tileSize cells
+     * contiguously, row major within a tile and with the tiles themselves in row major order, so
+     * a cell and all four of its neighbours are almost always in the same few cache lines. A Tiled
+     * lattice is also swept tile by tile, see sweep().
      */
-    enum State
+    enum Layout
     {
-        Red,
-        Green,
-        Blue,
-        MAXSTATE,
+        RowMajor,
+        Tiled,
     };
 
-    /// Look-up table for alive/dead cells symbols for printing.
-    static constexpr int stateSymbols[MAXSTATE] = {0,1,2};
-
 private:
     /// Member variable that holds number of rows in lattice.
-    int m_rowCount;
+    long long m_rowCount;
 
     /// Member variable that holds number of columns in lattice.
-    int m_colCount;
+    long long m_colCount;
+
+    /// Member variable that holds the actual data in the lattice, on the heap or in a mapped file.
+    LatticeStorage m_boardData;
+
+    /// Member variable that holds the memory layout of the cells.
+    Layout m_layout;
+
+    /// Member variable that holds log2 of the tile side when the layout is tiled.
+    int m_tileShift;
+
+    /// Member variable that holds the tile side minus one, for masking out the position in a tile.
+    long long m_tileMask;
+
+    /// Member variable that holds the number of tiles along a row.
+    long long m_tilesPerRow;
+
+    /// Member variable that holds the order tiles are visited in, reused between sweeps.
+    std::vector<long long> m_tileOrder;
+
+    /**
+     *\struct PendingUpdate
+     *\brief The random numbers of an update drawn ahead of time, with the cells they pick.
+     */
+    struct PendingUpdate
+    {
+        long long row;
+        long long col;
+        long long neighbourRow;
+        long long neighbourCol;
+        double uniform;
+    };
+
+    /// Member variable that holds the updates drawn ahead in a row major sweep, a ring of a power of two entries.
+    std::vector<PendingUpdate> m_pipeline = std::vector<PendingUpdate>(defaultPrefetchDistance);
+
+    /// Member variable that holds how many updates a row major sweep draws ahead, 0 for none.
+    int m_prefetchDistance{defaultPrefetchDistance};
+
+    /// Member variable that holds the number of cells in each state, kept up to date by every update.
+    long long m_stateCounts[MAXSTATE]{};
+
+    /// Member variable that holds the number of nearest neighbour bonds between each pair of states, see pairIndices.
+    long long m_bondCounts[MAXSTATE * (MAXSTATE + 1) / 2]{};
+
+    /// Member variable that holds the number of bonds between cells in different states.
+    long long m_unlikeBonds{};
+
+    /// Member variable that holds the total number of bonds.
+    long long m_totalBonds{};
+
+
+    /**
+     *\brief Sets up the layout members, throws std::invalid_argument if the tiles do not fit the lattice.
+     *\param layout memory layout of the cells.
+     *\param tileSize side of a tile, must be a power of two that divides the rows and columns.
+     */
+    void setLayout(ConsensusArray::Layout layout, int tileSize);
+
+    /**
+     *\brief Tries to invade a neighbour of a cell, the part of an update after its random numbers are drawn.
+     *\param row row index of the invading cell.
+     *\param col column index of the invading cell.
+     *\param neighbourRow row index of the neighbour.
+     *\param neighbourCol column index of the neighbour.
+     *\param uniform uniform random number in [0, 1) deciding whether the invasion happens.
+     *\return the state of the cell.
+     */
+    ConsensusArray::State attemptInvasion(long long row, long long col, long long neighbourRow, long long neighbourCol, double uniform);
+
+    /**
+     *\brief Performs a row major sweep, drawing each update's random numbers m_prefetchDistance updates
+     * ahead and prefetching the cells it will touch.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweepPipelined(std::default_random_engine& generator);
+
+protected:
+    /**
+     *\brief Picks the cell, or cells within each tile, of every update in a sweep and hands them to update.
+     *
+     * Shared by lattices that only differ in how a single update is done, the update is called as
+     * update(row, col) and is inlined, so the schedule costs nothing over a hand written loop.
+     *
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param update callable performing the update of a cell.
+     */
+    template<typename Update>
+    void sweepSchedule(std::default_random_engine& generator, Update update);
+
+    /**
+     *\brief Moves coordinates to one of the four neighbours of a cell.
+     *\param row row index of site in [0, #rows), set to the neighbour's row.
+     *\param col column index of site in [0, #columns), set to the neighbour's column.
+     *\param neighbour 0 to 3 for the right, lower, left and upper neighbour.
+     */
+    void moveToNeighbour(long long &row, long long &col, int neighbour) const;
 
-    /// Member variable that holds the actual data in the lattice.
-    std::vector<State> m_boardData;
+    /**
+     *\brief Sets the state of a cell and updates the species and bond counts from its four bonds.
+     *\param row row index of the cell.
+     *\param col column index of the cell.
+     *\param cell index of the cell in the storage.
+     *\param state new state of the cell.
+     */
+    void changeState(long long row, long long col, long long cell, ConsensusArray::State state);
 
-    /// Member variable for the probability of going from susceptible to infected.
-    double m_p_1;
+    /// Look-up table from an unordered pair of states to its entry in a table of bond counts.
+    static constexpr int pairIndices[MAXSTATE][MAXSTATE] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
 
-    double m_p_2;
+    /**
+     *\brief Replaces the species and bond counts with ones counted elsewhere, e.g. during a sweep.
+     *\param stateCounts number of cells in each state.
+     *\param bondCounts number of bonds between each pair of states, indexed by pairIndices.
+     */
+    void setCounts(const long long stateCounts[MAXSTATE], const long long bondCounts[MAXSTATE * (MAXSTATE + 1) / 2]);
 
 public:
+    /**
+     *\brief Calculates the position in memory of a cell inside the lattice.
+     *\param row row index of site in [0, #rows).
+     *\param col column index of site in [0, #columns).
+     *\return Integer value representing the index into the storage.
+     */
+    long long index(long long row, long long col) const;
+
     /**
      *\brief operator overload for getting the state at a site.
      *
@@ -58,7 +184,7 @@ public:
      *\param col column index of site.
      *\return reference to state stored at site so called can use it or set it.
      */
-    ConsensusArray::State& operator()(int row, int col);
+    ConsensusArray::State& operator()(long long row, long long col);
 
     /**
      *\brief constant version of non-constant counterpart for use with constant ConsensusArray object.
@@ -69,7 +195,7 @@ public:
      *\param col column index of site.
      *\return constant reference to state stored at site so called can use it only.
      */
-    const ConsensusArray::State& operator()(int row, int col) const;
+    const ConsensusArray::State& operator()(long long row, long long col) const;
 
     /**
      *\brief Constructor that initializes all cells to the state that is its arguments.
@@ -80,13 +206,17 @@ public:
      *\param probRS probability of recovered site becoming susceptible again.
      *\param state State instance to initialise all cells to will default to alive.
      *\param immuneFraction floating point instance representing the fraction of the population who are completely immune to the infection.
+     *\param layout memory layout of the cells.
+     *\param tileSize side of a tile in a tiled layout, a power of two that divides the rows and columns.
      */
     ConsensusArray(
-    	int rows = 50,
-    	int cols = 50,
+    	long long rows = 50,
+    	long long cols = 50,
     	double prob1 = 1.0,
     	double prob2 = 1.0,
-    	ConsensusArray::State state = ConsensusArray::Green);
+    	ConsensusArray::State state = ConsensusArray::Green,
+    	ConsensusArray::Layout layout = ConsensusArray::RowMajor,
+    	int tileSize = 64);
 
     /**
      *\brief Constructor that randomises lattice to an even mix of states.
@@ -97,13 +227,43 @@ public:
      *\param probRS probability of recovered site becoming susceptible again.
      *\param generator std::default_random_engine reference for generating random numbers.
      *\param immuneFraction floating point instance representing the fraction of the population who are completely immune to the infection.
+     *\param layout memory layout of the cells.
+     *\param tileSize side of a tile in a tiled layout, a power of two that divides the rows and columns.
      */
     ConsensusArray(
         std::default_random_engine &generator,
-    	int rows = 50,
-    	int cols = 50,
+    	long long rows = 50,
+    	long long cols = 50,
     	double prob1 = 1.0,
-    	double prob2 = 1.0
+    	double prob2 = 1.0,
+    	ConsensusArray::Layout layout = ConsensusArray::RowMajor,
+    	int tileSize = 64
+    	);
+
+    /**
+     *\brief Constructor that takes over existing cells, for example a lattice mapped from a file.
+     *
+     * The cells are used as they are, in the order given by the layout. A file backed lattice
+     * should normally be tiled: with a tile side of 64 each tile is exactly one 4KiB page, so the
+     * tile by tile sweep touches a handful of pages for every tile's worth of updates instead of a
+     * new page for almost every update.
+     *
+     *\param storage cells of the lattice, must hold rows*cols cells.
+     *\param rows number of rows on the board.
+     *\param cols number of columns on the board.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     *\param layout memory layout of the cells.
+     *\param tileSize side of a tile in a tiled layout, a power of two that divides the rows and columns.
+     */
+    ConsensusArray(
+        LatticeStorage &&storage,
+    	long long rows,
+    	long long cols,
+    	double prob1 = 1.0,
+    	double prob2 = 1.0,
+    	ConsensusArray::Layout layout = ConsensusArray::Tiled,
+    	int tileSize = 64
     	);
 
     /**
@@ -116,51 +276,43 @@ public:
      *\brief Getter for the number of rows.
      *\return Integer value representing the number of rows.
      */
-    int getRows() const;
+    long long getRows() const;
 
     /**
      *\brief Getter for number of columns.
      *\return Integer value representing the number of columns.
      */
-    int getCols() const;
+    long long getCols() const;
 
     /**
-     *\brief Getter for size of lattice #rows * #columns.
-     *\return Integer value representing the size of the lattice.
-     */
-    int getSize() const;
-
-    /**
-     *\brief Getter for the probability of going from susceptible to infected upon contact between two cells.
-     *\return Floating point value representing the probability of going from susceptible to infected upon contact.
+     *\brief Getter for the memory layout of the cells.
+     *\return Layout value.
      */
-    double getp1() const;
+    ConsensusArray::Layout getLayout() const;
 
     /**
-     *\brief Getter for the probability of going from infected to recovered.
-     *\return Floating point value representing the probability of going from infected to recovered.
+     *\brief Getter for the side of a tile, 1 for a row major layout.
+     *\return Integer value representing the tile side.
      */
-    double getp2() const;
+    int getTileSize() const;
 
     /**
-     *\brief Setter for the probability of going from susceptible to infected upon contact between two cells.
-     *\param prob floating point value representing the probability of going from susceptible to infected.
+     *\brief Getter for the storage holding the cells, in the order given by the layout.
+     *\return constant reference to the storage.
      */
-    void setp1(double prob);
+    const LatticeStorage& getStorage() const;
 
     /**
-     *\brief Setter for the probability of going from infected to recovered.
-     *\param prob floating point value representing the probability of going from infected to recovered.
+     *\brief Getter for the storage holding the cells so they can be filled in bulk.
+     *\return reference to the storage.
      */
-    void setp2(double prob);
+    LatticeStorage& getStorage();
 
     /**
-     *\brief returns probability of cell going from one state to another.
-     *\param state1 current state type.
-     *\param state2 proposed state type.
-     *\return probability of the update.
+     *\brief Getter for size of lattice #rows * #columns.
+     *\return Integer value representing the size of the lattice.
      */
-     double getProbability(ConsensusArray::State state1, ConsensusArray::State state2) const;
+    long long getSize() const override;
 
     /**
      *\brief Updates a random cell in the grid.
@@ -170,18 +322,85 @@ public:
     ConsensusArray::State update(std::default_random_engine& generator);
 
     /**
-     *\brief calculates the total number of cells in a given state.
+     *\brief Updates a given cell, it tries to invade one of its four neighbours at random.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param row row index of site in [0, #rows).
+     *\param col column index of site in [0, #columns).
+     *\return the state of the cell.
+     */
+    ConsensusArray::State update(std::default_random_engine& generator, long long row, long long col);
+
+    /**
+     *\brief Performs one sweep of the lattice, i.e. #rows * #columns random updates.
+     *
+     * A row major lattice picks every update's cell uniformly from the whole lattice. A tiled lattice
+     * visits the tiles in a random order and performs tileSize^2 updates of cells picked uniformly from
+     * within each one, so every cell still makes one update attempt per sweep on average while the
+     * working set stays in cache.
+     *
+     * On a lattice larger than the caches each row major update would wait on memory for its cells,
+     * so the random numbers of the following updates are drawn ahead and their cells prefetched, which
+     * keeps several cache misses in flight. The numbers are drawn in the same order and the updates
+     * done in the same order as without the pipeline, so the result is identical, see setPrefetchDistance().
+     *
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweep(std::default_random_engine& generator) override;
+
+    /**
+     *\brief Sets how many updates ahead a row major sweep draws and prefetches.
+     *\param distance number of updates, 0 turns the pipeline off.
+     */
+    void setPrefetchDistance(int distance);
+
+    /**
+     *\brief Getter for how many updates ahead a row major sweep draws and prefetches.
+     *\return Integer value representing the number of updates, 0 if the pipeline is off.
+     */
+    int getPrefetchDistance() const;
+
+    /**
+     *\brief Getter for the total number of cells in a given state, kept up to date by every update.
      *\param state value representing the state of interest.
      *\return Integer value representing the total number of cells in the state of interest
      */
-    int stateCount(ConsensusArray::State state) const;
+    long long stateCount(ConsensusArray::State state) const override;
 
     /**
-     *\brief calculates the total fraction of cells in a given state.
-     *\param state value representing the state of interest.
-     *\return Floating point value representing the fraction of cells in the state of interest
+     *\brief Getter for the number of nearest neighbour bonds between two states, kept up to date by every update.
+     *\param first state at one end of the bond.
+     *\param second state at the other end, which may be the same as first.
+     *\return Integer value representing the number of bonds.
      */
-    double stateFraction(ConsensusArray::State state) const;
+    long long bondCount(ConsensusArray::State first, ConsensusArray::State second) const;
+
+    /**
+     *\brief Getter for the number of bonds between cells in different states.
+     *\return Integer value representing the number of unlike bonds.
+     */
+    long long unlikeBondCount() const;
+
+    /**
+     *\brief Getter for the number of nearest neighbour bonds, which is 2*rows*cols less the self bonds of a side of length 1.
+     *\return Integer value representing the number of bonds.
+     */
+    long long totalBondCount() const;
+
+    /**
+     *\brief Calculates the interface density, the fraction of nearest neighbour bonds that are unlike, in O(1).
+     *\return Floating point value representing the interface density.
+     */
+    double interfaceDensity() const;
+
+    /**
+     *\brief Recounts the species and bonds from the cells.
+     *
+     * update() keeps the counts exact, touching only the four bonds of a cell that changes, but
+     * cells written any other way (through operator(), getStorage() or a mapped file) are not
+     * seen until this is called. LatticeInitialiser calls it after filling a lattice; a lattice
+     * made from a LatticeStorage reports no cells until then.
+     */
+    void recount();
 
     /**
      *\brief streams the board to an output stream in a nicely formatted way
@@ -193,4 +412,110 @@ public:
 
 };
 
+inline long long ConsensusArray::index(long long row, long long col) const
+{
+    if(ConsensusArray::RowMajor == m_layout)
+    {
+        return col + row * m_colCount;
+    }
+
+    // Select the tile, then the position within it.
+    long long tile = (row >> m_tileShift) * m_tilesPerRow + (col >> m_tileShift);
+    return (tile << (2 * m_tileShift)) | ((row & m_tileMask) << m_tileShift) | (col & m_tileMask);
+}
+
+inline void ConsensusArray::moveToNeighbour(long long &row, long long &col, int neighbour) const
+{
+    // The site is always inside the lattice so periodic boundaries only need a comparison rather than a modulo.
+    switch (neighbour) {
+      case 0:
+        col = (col + 1 == m_colCount) ? 0 : col + 1;
+        break;
+
+      case 1:
+        row = (row + 1 == m_rowCount) ? 0 : row + 1;
+        break;
+
+      case 2:
+        col = (0 == col) ? m_colCount - 1 : col - 1;
+        break;
+
+      case 3:
+        row = (0 == row) ? m_rowCount - 1 : row - 1;
+    }
+}
+
+inline void ConsensusArray::changeState(long long row, long long col, long long cell, ConsensusArray::State state)
+{
+    ConsensusArray::State old = m_boardData[cell];
+    if(old == state)
+    {
+        return;
+    }
+
+    m_boardData[cell] = state;
+    --m_stateCounts[old];
+    ++m_stateCounts[state];
+
+    // Only the four bonds of the changed cell change. A lattice one cell wide has no bond from a cell to itself.
+    for(int neighbour = 0; neighbour < 4; ++neighbour)
+    {
+        long long neighbourRow = row;
+        long long neighbourCol = col;
+        moveToNeighbour(neighbourRow, neighbourCol, neighbour);
+        long long other = index(neighbourRow, neighbourCol);
+        if(other == cell)
+        {
+            continue;
+        }
+
+        ConsensusArray::State otherState = m_boardData[other];
+        --m_bondCounts[pairIndices[old][otherState]];
+        ++m_bondCounts[pairIndices[state][otherState]];
+        m_unlikeBonds += (state != otherState) - (old != otherState);
+    }
+}
+
+template<typename Update>
+void ConsensusArray::sweepSchedule(std::default_random_engine& generator, Update update)
+{
+    if(ConsensusArray::RowMajor == m_layout)
+    {
+        // Perform row*col random updates so that on average every cell is updated once.
+        std::uniform_int_distribution<long long> rowDistribution(0, m_rowCount - 1);
+        std::uniform_int_distribution<long long> colDistribution(0, m_colCount - 1);
+
+        long long size = getSize();
+        for(long long i = 0; i < size; ++i)
+        {
+            long long row = rowDistribution(generator);
+            long long col = colDistribution(generator);
+            update(row, col);
+        }
+        return;
+    }
+
+    // Visit the tiles in a random order.
+    std::iota(m_tileOrder.begin(), m_tileOrder.end(), 0);
+    std::shuffle(m_tileOrder.begin(), m_tileOrder.end(), generator);
+
+    int tileSize = 1 << m_tileShift;
+    long long tileUpdates = static_cast<long long>(tileSize) * tileSize;
+    std::uniform_int_distribution<long long> offsetDistribution(0, m_tileMask);
+
+    // Perform one update per cell of each tile, on cells picked at random from within the tile.
+    for(long long tile : m_tileOrder)
+    {
+        long long firstRow = (tile / m_tilesPerRow) << m_tileShift;
+        long long firstCol = (tile % m_tilesPerRow) << m_tileShift;
+
+        for(long long i = 0; i < tileUpdates; ++i)
+        {
+            long long row = firstRow + offsetDistribution(generator);
+            long long col = firstCol + offsetDistribution(generator);
+            update(row, col);
+        }
+    }
+}
+
 #endif /* ConsensusArray_hpp */
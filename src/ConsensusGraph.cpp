@@ -0,0 +1,509 @@
+#include "ConsensusGraph.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+#include <stdexcept>
+
+namespace
+{
+    /// Key that identifies an undirected edge irrespective of the order of its end points.
+    std::uint64_t edgeKey(ConsensusGraph::Vertex a, ConsensusGraph::Vertex b)
+    {
+        if(a > b)
+        {
+            std::swap(a, b);
+        }
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+
+    /**
+     * Calls function(a, b) for every edge in a whitespace separated edge list held in memory.
+     * Lines beginning with '#' or '%' are skipped, as is anything after the second label.
+     */
+    template<typename Function>
+    void forEachEdge(const char *data, std::size_t size, Function function)
+    {
+        const char *position = data;
+        const char *end = data + size;
+
+        auto skipBlanks = [&]() {
+            while(position < end && (*position == ' ' || *position == '\t' || *position == '\r'))
+            {
+                ++position;
+            }
+        };
+
+        auto skipLine = [&]() {
+            while(position < end && *position != '\n')
+            {
+                ++position;
+            }
+            if(position < end)
+            {
+                ++position;
+            }
+        };
+
+        auto readLabel = [&](bool &ok) {
+            std::uint64_t value = 0;
+            ok = position < end && *position >= '0' && *position <= '9';
+            while(position < end && *position >= '0' && *position <= '9')
+            {
+                value = value * 10 + static_cast<std::uint64_t>(*position - '0');
+                ++position;
+            }
+            return static_cast<ConsensusGraph::Vertex>(value);
+        };
+
+        while(position < end)
+        {
+            skipBlanks();
+            if(position < end && (*position == '#' || *position == '%' || *position == '\n'))
+            {
+                skipLine();
+                continue;
+            }
+
+            bool okA;
+            bool okB;
+            ConsensusGraph::Vertex a = readLabel(okA);
+            skipBlanks();
+            ConsensusGraph::Vertex b = readLabel(okB);
+
+            if(okA && okB)
+            {
+                function(a, b);
+            }
+
+            skipLine();
+        }
+    }
+}
+
+ConsensusGraph::ConsensusGraph(
+    std::default_random_engine &generator,
+    ConsensusGraph::Vertex vertexCount,
+    const std::vector<ConsensusGraph::Edge> &edges,
+    double prob1,
+    double prob2,
+    bool reorderVertices
+    ) : ConsensusModel(prob1, prob2)
+{
+    buildAdjacency(vertexCount, edges);
+
+    if(reorderVertices)
+    {
+        reorder();
+    }
+
+    initialiseStates(generator);
+}
+
+ConsensusGraph::ConsensusGraph(
+    std::default_random_engine &generator,
+    const std::string &fileName,
+    double prob1,
+    double prob2,
+    bool reorderVertices
+    ) : ConsensusModel(prob1, prob2)
+{
+    MappedFile file(fileName);
+
+    // First pass counts the degrees, growing the vertex set as larger labels are found.
+    std::vector<long long> degrees;
+    forEachEdge(file.data(), file.size(), [&](Vertex a, Vertex b) {
+        if(a == b)
+        {
+            return;
+        }
+        Vertex largest = std::max(a, b);
+        if(largest >= degrees.size())
+        {
+            degrees.resize(static_cast<std::size_t>(largest) + 1, 0);
+        }
+        ++degrees[a];
+        ++degrees[b];
+    });
+
+    m_offsets.assign(degrees.size() + 1, 0);
+    std::partial_sum(degrees.begin(), degrees.end(), m_offsets.begin() + 1);
+
+    // Second pass writes each end point straight into its slot in the adjacency.
+    m_neighbours.resize(m_offsets.back());
+    std::vector<long long> cursor(m_offsets.begin(), m_offsets.end() - 1);
+    forEachEdge(file.data(), file.size(), [&](Vertex a, Vertex b) {
+        if(a == b)
+        {
+            return;
+        }
+        m_neighbours[cursor[a]++] = b;
+        m_neighbours[cursor[b]++] = a;
+    });
+
+    if(reorderVertices)
+    {
+        reorder();
+    }
+
+    initialiseStates(generator);
+}
+
+void ConsensusGraph::buildAdjacency(ConsensusGraph::Vertex vertexCount, const std::vector<ConsensusGraph::Edge> &edges)
+{
+    // Count the degree of each vertex, offset by one so a prefix sum gives the offsets.
+    m_offsets.assign(static_cast<std::size_t>(vertexCount) + 1, 0);
+    for(const auto &edge : edges)
+    {
+        if(edge.first != edge.second)
+        {
+            ++m_offsets[edge.first + 1];
+            ++m_offsets[edge.second + 1];
+        }
+    }
+    std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+
+    m_neighbours.resize(m_offsets.back());
+    std::vector<long long> cursor(m_offsets.begin(), m_offsets.end() - 1);
+    for(const auto &edge : edges)
+    {
+        if(edge.first != edge.second)
+        {
+            m_neighbours[cursor[edge.first]++] = edge.second;
+            m_neighbours[cursor[edge.second]++] = edge.first;
+        }
+    }
+}
+
+void ConsensusGraph::reorder()
+{
+    Vertex vertexCount = static_cast<Vertex>(m_offsets.size() - 1);
+
+    // Each component is started from its lowest degree vertex.
+    std::vector<Vertex> byDegree(vertexCount);
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(), [this](Vertex a, Vertex b) {
+        return getDegree(a) < getDegree(b);
+    });
+
+    // Cuthill-McKee: a breadth first search that visits neighbours in order of increasing degree.
+    std::vector<Vertex> order;
+    order.reserve(vertexCount);
+    std::vector<char> visited(vertexCount, 0);
+    std::vector<Vertex> frontier;
+
+    for(Vertex start : byDegree)
+    {
+        if(visited[start])
+        {
+            continue;
+        }
+
+        visited[start] = 1;
+        order.push_back(start);
+
+        for(std::size_t head = order.size() - 1; head < order.size(); ++head)
+        {
+            Vertex vertex = order[head];
+
+            frontier.clear();
+            for(long long edge = m_offsets[vertex]; edge < m_offsets[vertex + 1]; ++edge)
+            {
+                Vertex neighbour = m_neighbours[edge];
+                if(!visited[neighbour])
+                {
+                    visited[neighbour] = 1;
+                    frontier.push_back(neighbour);
+                }
+            }
+
+            std::sort(frontier.begin(), frontier.end(), [this](Vertex a, Vertex b) {
+                return getDegree(a) < getDegree(b);
+            });
+            order.insert(order.end(), frontier.begin(), frontier.end());
+        }
+    }
+
+    // Reversing the order gives the reverse Cuthill-McKee labelling, which has a lower profile.
+    std::reverse(order.begin(), order.end());
+
+    std::vector<Vertex> newLabel(vertexCount);
+    for(Vertex label = 0; label < vertexCount; ++label)
+    {
+        newLabel[order[label]] = label;
+    }
+
+    std::vector<long long> offsets(m_offsets.size(), 0);
+    std::vector<Vertex> neighbours;
+    neighbours.reserve(m_neighbours.size());
+
+    for(Vertex label = 0; label < vertexCount; ++label)
+    {
+        Vertex vertex = order[label];
+        for(long long edge = m_offsets[vertex]; edge < m_offsets[vertex + 1]; ++edge)
+        {
+            neighbours.push_back(newLabel[m_neighbours[edge]]);
+        }
+
+        // Sorted neighbour lists mean the states of a vertex's neighbours are read in address order.
+        std::sort(neighbours.begin() + offsets[label], neighbours.end());
+        offsets[label + 1] = static_cast<long long>(neighbours.size());
+    }
+
+    m_offsets.swap(offsets);
+    m_neighbours.swap(neighbours);
+}
+
+void ConsensusGraph::initialiseStates(std::default_random_engine &generator)
+{
+    m_states.resize(m_offsets.size() - 1);
+    randomise(generator);
+}
+
+std::vector<ConsensusGraph::Edge> ConsensusGraph::randomRegularEdges(
+    ConsensusGraph::Vertex vertexCount,
+    int degree,
+    std::default_random_engine &generator)
+{
+    if((static_cast<long long>(vertexCount) * degree) % 2 != 0)
+    {
+        throw std::invalid_argument("The number of vertices times the degree must be even for a regular graph.");
+    }
+
+    // Give every vertex degree stubs and pair them up at random.
+    std::vector<Vertex> stubs;
+    stubs.reserve(static_cast<std::size_t>(vertexCount) * degree);
+    for(Vertex vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        stubs.insert(stubs.end(), degree, vertex);
+    }
+    std::shuffle(stubs.begin(), stubs.end(), generator);
+
+    std::vector<Edge> edges;
+    edges.reserve(stubs.size() / 2);
+    for(std::size_t stub = 0; stub + 1 < stubs.size(); stub += 2)
+    {
+        edges.emplace_back(stubs[stub], stubs[stub + 1]);
+    }
+
+    // Record the simple edges and collect the self-loops and multi-edges that need repairing.
+    std::unordered_set<std::uint64_t> present;
+    present.reserve(edges.size() * 2);
+    std::vector<std::size_t> defective;
+    std::vector<char> isDefective(edges.size(), 0);
+
+    for(std::size_t index = 0; index < edges.size(); ++index)
+    {
+        const Edge &edge = edges[index];
+        if(edge.first == edge.second || !present.insert(edgeKey(edge.first, edge.second)).second)
+        {
+            defective.push_back(index);
+            isDefective[index] = 1;
+        }
+    }
+
+    // Repair each defect by swapping end points with a random simple edge: (u,v),(x,y) -> (u,x),(v,y).
+    std::uniform_int_distribution<std::size_t> edgeDistribution(0, edges.empty() ? 0 : edges.size() - 1);
+    const int maxAttempts = 100;
+
+    for(std::size_t index : defective)
+    {
+        Vertex u = edges[index].first;
+        Vertex v = edges[index].second;
+
+        for(int attempt = 0; attempt < maxAttempts; ++attempt)
+        {
+            std::size_t other = edgeDistribution(generator);
+            if(isDefective[other])
+            {
+                continue;
+            }
+
+            Vertex x = edges[other].first;
+            Vertex y = edges[other].second;
+
+            if(u == x || v == y || present.count(edgeKey(u, x)) || present.count(edgeKey(v, y))
+                || edgeKey(u, x) == edgeKey(v, y))
+            {
+                continue;
+            }
+
+            present.erase(edgeKey(x, y));
+            present.insert(edgeKey(u, x));
+            present.insert(edgeKey(v, y));
+            edges[index] = Edge(u, x);
+            edges[other] = Edge(v, y);
+            isDefective[index] = 0;
+            break;
+        }
+    }
+
+    // Anything that could not be repaired is dropped.
+    std::vector<Edge> simpleEdges;
+    simpleEdges.reserve(edges.size());
+    for(std::size_t index = 0; index < edges.size(); ++index)
+    {
+        if(!isDefective[index])
+        {
+            simpleEdges.push_back(edges[index]);
+        }
+    }
+
+    return simpleEdges;
+}
+
+std::vector<ConsensusGraph::Edge> ConsensusGraph::smallWorldEdges(
+    ConsensusGraph::Vertex vertexCount,
+    int degree,
+    double rewireProbability,
+    std::default_random_engine &generator)
+{
+    // Start from a ring where every vertex is joined to its degree/2 nearest neighbours on each side.
+    std::vector<Edge> edges;
+    std::unordered_set<std::uint64_t> present;
+    edges.reserve(static_cast<std::size_t>(vertexCount) * (degree / 2));
+    present.reserve(static_cast<std::size_t>(vertexCount) * degree);
+
+    for(Vertex vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        for(int offset = 1; offset <= degree / 2; ++offset)
+        {
+            Vertex neighbour = static_cast<Vertex>((static_cast<long long>(vertex) + offset) % vertexCount);
+            if(vertex != neighbour && present.insert(edgeKey(vertex, neighbour)).second)
+            {
+                edges.emplace_back(vertex, neighbour);
+            }
+        }
+    }
+
+    // Rewire the far end of each ring edge with the given probability, avoiding self-loops and multi-edges.
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    std::uniform_int_distribution<Vertex> vertexDistribution(0, vertexCount - 1);
+    const int maxAttempts = 100;
+
+    for(auto &edge : edges)
+    {
+        if(distribution(generator) >= rewireProbability)
+        {
+            continue;
+        }
+
+        for(int attempt = 0; attempt < maxAttempts; ++attempt)
+        {
+            Vertex target = vertexDistribution(generator);
+            if(target != edge.first && !present.count(edgeKey(edge.first, target)))
+            {
+                present.erase(edgeKey(edge.first, edge.second));
+                present.insert(edgeKey(edge.first, target));
+                edge.second = target;
+                break;
+            }
+        }
+    }
+
+    return edges;
+}
+
+std::vector<ConsensusGraph::Edge> ConsensusGraph::squareLatticeEdges(ConsensusGraph::Vertex rows, ConsensusGraph::Vertex cols)
+{
+    std::vector<Edge> edges;
+    edges.reserve(2 * static_cast<std::size_t>(rows) * cols);
+
+    for(Vertex row = 0; row < rows; ++row)
+    {
+        for(Vertex col = 0; col < cols; ++col)
+        {
+            Vertex site = col + row * cols;
+            edges.emplace_back(site, (col + 1) % cols + row * cols);
+            edges.emplace_back(site, col + ((row + 1) % rows) * cols);
+        }
+    }
+
+    return edges;
+}
+
+void ConsensusGraph::randomise(std::default_random_engine &generator)
+{
+    static std::uniform_int_distribution<int> distribution(0,static_cast<int>(ConsensusModel::MAXSTATE)-1);
+
+    for(auto &state : m_states)
+    {
+        state = static_cast<ConsensusModel::State>(distribution(generator));
+    }
+}
+
+long long ConsensusGraph::getSize() const
+{
+    return static_cast<long long>(m_states.size());
+}
+
+long long ConsensusGraph::getEdgeCount() const
+{
+    return static_cast<long long>(m_neighbours.size());
+}
+
+long long ConsensusGraph::getDegree(ConsensusGraph::Vertex vertex) const
+{
+    return m_offsets[vertex + 1] - m_offsets[vertex];
+}
+
+ConsensusModel::State& ConsensusGraph::operator[](ConsensusGraph::Vertex vertex)
+{
+    return m_states[vertex];
+}
+
+const ConsensusModel::State& ConsensusGraph::operator[](ConsensusGraph::Vertex vertex) const
+{
+    return m_states[vertex];
+}
+
+ConsensusModel::State ConsensusGraph::update(std::default_random_engine &generator)
+{
+    std::uniform_int_distribution<long long> vertexDistribution(0, getSize() - 1);
+    static std::uniform_real_distribution<double> distribution(0.0,1.0);
+
+    Vertex vertex = static_cast<Vertex>(vertexDistribution(generator));
+
+    long long first = m_offsets[vertex];
+    long long degree = m_offsets[vertex + 1] - first;
+
+    // Isolated vertices have no one to invade.
+    if(0 == degree)
+    {
+        return m_states[vertex];
+    }
+
+    // Scaling a number in [0,1) by the degree selects a neighbour without branching on which one.
+    Vertex neighbour = m_neighbours[first + static_cast<long long>(distribution(generator) * degree)];
+
+    if(distribution(generator) < getProbability(m_states[vertex], m_states[neighbour]))
+    {
+        m_states[neighbour] = m_states[vertex];
+    }
+
+    return m_states[vertex];
+}
+
+void ConsensusGraph::sweep(std::default_random_engine &generator)
+{
+    long long size = getSize();
+    for(long long i = 0; i < size; ++i)
+    {
+        update(generator);
+    }
+}
+
+long long ConsensusGraph::stateCount(ConsensusModel::State state) const
+{
+    return std::count(m_states.begin(), m_states.end(), state);
+}
+
+std::ostream& operator<<(std::ostream& out, const ConsensusGraph &graph)
+{
+    for(const auto &state : graph.m_states)
+    {
+        out << static_cast<int>(state) << '\n';
+    }
+
+    return out;
+}
@@ -0,0 +1,199 @@
+#ifndef ConsensusGraph_hpp
+#define ConsensusGraph_hpp
+
+#include <vector> // For holding the adjacency and state data.
+#include <random> // For generating random numbers.
+#include <string> // For edge list file names.
+#include <utility> // For std::pair.
+#include <cstdint> // For fixed width vertex indices.
+#include <iostream> // For outputting the states.
+#include "ConsensusModel.hpp"
+
+/**
+ * \file
+ * \class ConsensusGraph
+ * \brief Class to model the Consensus dynamics on an arbitrary undirected network.
+ *
+ * The adjacency is stored in compressed sparse row (CSR) form: the neighbours of vertex v are
+ * m_neighbours[m_offsets[v]] ... m_neighbours[m_offsets[v+1]-1]. A random neighbour is then
+ * picked by scaling a uniform number by the degree and adding it to the offset, with no branching
+ * on the neighbour. By default vertices are relabelled in reverse Cuthill-McKee order so that
+ * neighbouring vertices, and hence their states, are close together in memory.
+ */
+class ConsensusGraph : public ConsensusModel
+{
+public:
+    /// Type used to label vertices.
+    using Vertex = std::uint32_t;
+
+    /// Type used to hold an undirected edge.
+    using Edge = std::pair<Vertex, Vertex>;
+
+private:
+    /// Member variable that holds the start of each vertex's neighbours, size is #vertices + 1.
+    std::vector<long long> m_offsets;
+
+    /// Member variable that holds the concatenated neighbour lists.
+    std::vector<Vertex> m_neighbours;
+
+    /// Member variable that holds the state of each vertex.
+    std::vector<State> m_states;
+
+    /**
+     *\brief Builds the CSR adjacency from an edge list, adding both directions of every edge.
+     *\param vertexCount number of vertices.
+     *\param edges undirected edge list.
+     */
+    void buildAdjacency(Vertex vertexCount, const std::vector<Edge> &edges);
+
+    /**
+     *\brief Relabels the vertices in reverse Cuthill-McKee order.
+     */
+    void reorder();
+
+    /**
+     *\brief Sets every vertex to a uniformly random state.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void initialiseStates(std::default_random_engine &generator);
+
+public:
+    /**
+     *\brief Constructor that builds the network from an edge list and randomises the states.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param vertexCount number of vertices in the network.
+     *\param edges undirected edge list, self-loops are ignored.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     *\param reorderVertices if true relabel vertices in reverse Cuthill-McKee order.
+     */
+    ConsensusGraph(
+        std::default_random_engine &generator,
+        Vertex vertexCount,
+        const std::vector<Edge> &edges,
+        double prob1 = 1.0,
+        double prob2 = 1.0,
+        bool reorderVertices = true
+        );
+
+    /**
+     *\brief Constructor that loads the network from a whitespace separated edge list file.
+     *
+     * The file is memory-mapped and parsed in two passes, one to count degrees and one to fill the
+     * adjacency, so no intermediate edge list is ever held in memory. Lines starting with '#' or '%'
+     * are comments and the number of vertices is one more than the largest label.
+     *
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param fileName path of the edge list.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     *\param reorderVertices if true relabel vertices in reverse Cuthill-McKee order.
+     */
+    ConsensusGraph(
+        std::default_random_engine &generator,
+        const std::string &fileName,
+        double prob1 = 1.0,
+        double prob2 = 1.0,
+        bool reorderVertices = true
+        );
+
+    /**
+     *\brief Generates a random k-regular graph with the pairing (configuration) model.
+     *
+     * Self-loops and multi-edges are removed by random edge swaps, any that cannot be repaired
+     * are dropped so a handful of vertices may have a slightly lower degree.
+     *
+     *\param vertexCount number of vertices, vertexCount*degree must be even.
+     *\param degree degree of every vertex.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\return vector of undirected edges.
+     */
+    static std::vector<Edge> randomRegularEdges(Vertex vertexCount, int degree, std::default_random_engine &generator);
+
+    /**
+     *\brief Generates a Watts-Strogatz small-world network.
+     *\param vertexCount number of vertices.
+     *\param degree even degree of the initial ring lattice.
+     *\param rewireProbability probability that each ring edge is rewired to a random vertex.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\return vector of undirected edges.
+     */
+    static std::vector<Edge> smallWorldEdges(Vertex vertexCount, int degree, double rewireProbability, std::default_random_engine &generator);
+
+    /**
+     *\brief Generates a periodic square lattice, identical in connectivity to ConsensusArray.
+     *\param rows number of rows.
+     *\param cols number of columns.
+     *\return vector of undirected edges.
+     */
+    static std::vector<Edge> squareLatticeEdges(Vertex rows, Vertex cols);
+
+    /**
+     *\brief Randomises the vertex states with equal probability of being in each state.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void randomise(std::default_random_engine &generator);
+
+    /**
+     *\brief Getter for the number of vertices.
+     *\return Integer value representing the number of vertices.
+     */
+    long long getSize() const override;
+
+    /**
+     *\brief Getter for the number of directed edges, i.e. twice the number of undirected edges.
+     *\return Integer value representing the number of adjacency entries.
+     */
+    long long getEdgeCount() const;
+
+    /**
+     *\brief Getter for the degree of a vertex.
+     *\param vertex label of the vertex.
+     *\return Integer value representing the degree.
+     */
+    long long getDegree(Vertex vertex) const;
+
+    /**
+     *\brief Getter for the state of a vertex.
+     *\param vertex label of the vertex.
+     *\return reference to the state so the caller can use or set it.
+     */
+    State& operator[](Vertex vertex);
+
+    /**
+     *\brief Constant version of the non-constant counterpart.
+     *\param vertex label of the vertex.
+     *\return constant reference to the state.
+     */
+    const State& operator[](Vertex vertex) const;
+
+    /**
+     *\brief Updates a random vertex: it tries to invade a random neighbour.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\return the state of the chosen vertex.
+     */
+    State update(std::default_random_engine &generator);
+
+    /**
+     *\brief Performs one sweep, i.e. #vertices random updates.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweep(std::default_random_engine &generator) override;
+
+    /**
+     *\brief calculates the total number of vertices in a given state.
+     *\param state value representing the state of interest.
+     *\return Integer value representing the number of vertices in the state of interest.
+     */
+    long long stateCount(State state) const override;
+
+    /**
+     *\brief streams the vertex states to an output stream, one vertex per line.
+     *\param out std::ostream reference that is being streamed to.
+     *\param graph ConsensusGraph reference to be printed.
+     *\return std::ostream reference to output can be chained.
+     */
+    friend std::ostream& operator<<(std::ostream& out, const ConsensusGraph &graph);
+};
+
+#endif /* ConsensusGraph_hpp */
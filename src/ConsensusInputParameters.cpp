@@ -10,5 +10,7 @@ std::ostream& operator<<(std::ostream& out, const ConsensusInputParameters& para
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "p_2: " << std::right << params.p_2 << '\n';
     out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Sweeps: " << std::right << params.sweeps << '\n';
 		out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Output-Directory: " << std::right << params.outputDirectory << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Engine: " << std::right << params.engine << '\n';
+    out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Population: " << std::right << params.population << '\n';
     return out;
 }
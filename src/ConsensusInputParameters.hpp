@@ -16,9 +16,9 @@ class ConsensusInputParameters
 public:
 
 	/// Number of rows in lattice.
-	int rowCount;
+	long long rowCount;
 	/// Number of columns in lattice.
-	int colCount;
+	long long colCount;
 	/// Probability of cell going from susceptible to infected upon contact.
 	double p_1;
 	/// Probability of cell going from infected to recovered.
@@ -27,6 +27,10 @@ public:
 	int sweeps;
 	/// Output directory.
 	std::string outputDirectory;
+	/// Name of the engine used to simulate the population.
+	std::string engine;
+	/// Total number of individuals in the population.
+	long long population;
 
 
     /**
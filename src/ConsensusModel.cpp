@@ -0,0 +1,60 @@
+#include "ConsensusModel.hpp"
+
+ConsensusModel::ConsensusModel(double prob1, double prob2) : m_p_1{prob1}, m_p_2{prob2}
+{
+
+}
+
+double ConsensusModel::getp1() const
+{
+	return m_p_1;
+}
+
+double ConsensusModel::getp2() const
+{
+	return m_p_2;
+}
+
+void ConsensusModel::setp1(double prob)
+{
+	m_p_1 = prob;
+}
+
+void ConsensusModel::setp2(double prob)
+{
+	m_p_2 = prob;
+}
+
+double ConsensusModel::getProbability(ConsensusModel::State state1, ConsensusModel::State state2) const
+{
+  if((state1==ConsensusModel::Red && state2==ConsensusModel::Green)
+      || (state1==ConsensusModel::Green && state2 == ConsensusModel::Blue)
+      || (state1==ConsensusModel::Blue && state2 == ConsensusModel::Red))
+      {
+        return m_p_1;
+      }
+  else if((state1==ConsensusModel::Green && state2==ConsensusModel::Red)
+      || (state1==ConsensusModel::Blue && state2 == ConsensusModel::Green)
+      || (state1==ConsensusModel::Red && state2 == ConsensusModel::Blue))
+      {
+        return m_p_2;
+      }
+  else
+  {
+    return 0;
+  }
+}
+
+double ConsensusModel::stateFraction(ConsensusModel::State state) const
+{
+	return static_cast<double>(stateCount(state))/getSize();
+}
+
+bool ConsensusModel::isAbsorbed() const
+{
+	long long size = getSize();
+
+	return (stateCount(ConsensusModel::Red) == size)
+		|| (stateCount(ConsensusModel::Green) == size)
+		|| (stateCount(ConsensusModel::Blue) == size);
+}
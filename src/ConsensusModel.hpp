@@ -0,0 +1,117 @@
+#ifndef ConsensusModel_hpp
+#define ConsensusModel_hpp
+
+#include <random> // For generating random numbers.
+#include <cstdint> // For the one byte state type.
+
+/**
+ * \file
+ * \brief Abstract base class for any engine that simulates the three species Consensus model.
+ *
+ * The lattice, well-mixed and any other engines all share the same species, the same pair of
+ * invasion probabilities and the same sweep-level interface, so the measurement and output code
+ * in main can drive any of them without knowing how the population is stored.
+ */
+class ConsensusModel
+{
+public:
+    /**
+     * \enum State
+     * \brief Enumeration type to hold the state of the cell.
+     *
+     * Stored in a single byte so that as much of a large population as possible fits in cache.
+     */
+    enum State : std::uint8_t
+    {
+        Red,
+        Green,
+        Blue,
+        MAXSTATE,
+    };
+
+protected:
+    /// Member variable for the probability of a cyclic (red->green->blue->red) invasion.
+    double m_p_1;
+
+    /// Member variable for the probability of an anti-cyclic invasion.
+    double m_p_2;
+
+public:
+    /**
+     *\brief Constructor that sets the invasion probabilities.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     */
+    ConsensusModel(double prob1 = 1.0, double prob2 = 1.0);
+
+    /**
+     *\brief Virtual destructor so engines can be owned through a base class pointer.
+     */
+    virtual ~ConsensusModel() = default;
+
+    /**
+     *\brief Getter for the probability of a cyclic invasion.
+     *\return Floating point value representing p_1.
+     */
+    double getp1() const;
+
+    /**
+     *\brief Getter for the probability of an anti-cyclic invasion.
+     *\return Floating point value representing p_2.
+     */
+    double getp2() const;
+
+    /**
+     *\brief Setter for the probability of a cyclic invasion.
+     *\param prob floating point value representing p_1.
+     */
+    void setp1(double prob);
+
+    /**
+     *\brief Setter for the probability of an anti-cyclic invasion.
+     *\param prob floating point value representing p_2.
+     */
+    void setp2(double prob);
+
+    /**
+     *\brief returns probability of cell going from one state to another.
+     *\param state1 current state type.
+     *\param state2 proposed state type.
+     *\return probability of the update.
+     */
+    double getProbability(State state1, State state2) const;
+
+    /**
+     *\brief Getter for the total number of individuals in the population.
+     *\return Integer value representing the size of the population.
+     */
+    virtual long long getSize() const = 0;
+
+    /**
+     *\brief calculates the total number of individuals in a given state.
+     *\param state value representing the state of interest.
+     *\return Integer value representing the total number of individuals in the state of interest.
+     */
+    virtual long long stateCount(State state) const = 0;
+
+    /**
+     *\brief calculates the total fraction of individuals in a given state.
+     *\param state value representing the state of interest.
+     *\return Floating point value representing the fraction of individuals in the state of interest.
+     */
+    double stateFraction(State state) const;
+
+    /**
+     *\brief Advances the model by one sweep, i.e. on average one update attempt per individual.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    virtual void sweep(std::default_random_engine &generator) = 0;
+
+    /**
+     *\brief Checks whether the population has reached an absorbing (single species) state.
+     *\return Boolean which is true if every individual is in the same state.
+     */
+    bool isAbsorbed() const;
+};
+
+#endif /* ConsensusModel_hpp */
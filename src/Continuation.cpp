@@ -0,0 +1,72 @@
+#include "Continuation.hpp"
+#include "DataArray.hpp"
+#include <stdexcept>
+
+Continuation::Continuation(int equilibrationSweeps, int measurementSweeps, int measurementInterval) :
+	m_equilibrationSweeps{equilibrationSweeps},
+	m_measurementSweeps{measurementSweeps},
+	m_measurementInterval{measurementInterval > 0 ? measurementInterval : 1}
+{
+
+}
+
+std::vector<Continuation::Point> Continuation::points(const std::vector<double> &p1Values, const std::vector<double> &p2Values, bool bothWays)
+{
+	if(p1Values.size() != 1 && p1Values.size() != p2Values.size())
+	{
+		throw std::invalid_argument("Continuation needs one value of p_1 or one for every value of p_2");
+	}
+
+	std::vector<Continuation::Point> scan;
+	for(std::size_t point = 0; point < p2Values.size(); ++point)
+	{
+		scan.push_back(Point{p1Values.size() == 1 ? p1Values[0] : p1Values[point], p2Values[point], 1});
+	}
+
+	// The turning point is not repeated on the way back.
+	if(bothWays)
+	{
+		for(std::size_t point = scan.size() - 1; point-- > 0;)
+		{
+			scan.push_back(Point{scan[point].p1, scan[point].p2, -1});
+		}
+	}
+
+	return scan;
+}
+
+void Continuation::run(ConsensusModel &model, std::default_random_engine &generator, const std::vector<Continuation::Point> &points, std::ostream &out) const
+{
+	for(std::size_t point = 0; point < points.size(); ++point)
+	{
+		model.setp1(points[point].p1);
+		model.setp2(points[point].p2);
+
+		for(int sweep = 0; sweep < m_equilibrationSweeps; ++sweep)
+		{
+			model.sweep(generator);
+		}
+
+		DataArray fractions[ConsensusModel::MAXSTATE];
+		for(int sweep = 0; sweep < m_measurementSweeps; ++sweep)
+		{
+			model.sweep(generator);
+
+			if(0 == sweep%m_measurementInterval)
+			{
+				for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+				{
+					fractions[state].push_back(model.stateFraction(static_cast<ConsensusModel::State>(state)));
+				}
+			}
+		}
+
+		out << point << ' ' << points[point].direction
+		    << ' ' << points[point].p1 << ' ' << points[point].p2;
+		for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+		{
+			out << ' ' << fractions[state].mean() << ' ' << fractions[state].error();
+		}
+		out << ' ' << model.isAbsorbed() << std::endl;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef Continuation_hpp
+#define Continuation_hpp
+
+#include <vector> // For the list of points.
+#include <random> // For the generator.
+#include <iostream> // For the summary table.
+#include "ConsensusModel.hpp"
+
+/**
+ *\file
+ *\class Continuation
+ *\brief Class that scans the model through a list of (p_1, p_2) points, carrying the state over between them.
+ *
+ * Rather than starting every point of a scan from a fresh random state, the model is left as the
+ * previous point finished and only re-equilibrated for a number of sweeps before measuring, which
+ * is much cheaper when neighbouring points have similar stationary states. Running the list
+ * forwards and then backwards shows any hysteresis between the two branches.
+ *
+ * Once the model has been absorbed it can never leave the absorbing state, so every later point
+ * is reported as absorbed too.
+ */
+class Continuation
+{
+public:
+	/**
+	 *\struct Point
+	 *\brief A pair of invasion probabilities.
+	 */
+	struct Point
+	{
+		/// Probability of a cyclic invasion.
+		double p1;
+		/// Probability of an anti-cyclic invasion.
+		double p2;
+		/// 1 on the way out and -1 on the way back.
+		int direction;
+	};
+
+private:
+	/// Member variable that holds the number of sweeps run after changing the probabilities before measuring.
+	int m_equilibrationSweeps;
+
+	/// Member variable that holds the number of sweeps measured at each point.
+	int m_measurementSweeps;
+
+	/// Member variable that holds the number of sweeps between measurements.
+	int m_measurementInterval;
+
+public:
+	/**
+	 *\brief Constructor.
+	 *\param equilibrationSweeps sweeps run at each point before measuring.
+	 *\param measurementSweeps sweeps measured at each point.
+	 *\param measurementInterval sweeps between measurements.
+	 */
+	Continuation(int equilibrationSweeps, int measurementSweeps, int measurementInterval = 10);
+
+	/**
+	 *\brief Builds the points of a scan, optionally followed by the same points in reverse.
+	 *\param p1Values values of p_1, either one for every point or a single value used for all of them.
+	 *\param p2Values values of p_2.
+	 *\param bothWays true to return along the same points after reaching the last one.
+	 *\return the points in the order they are visited, throws std::invalid_argument if the lists do not match.
+	 */
+	static std::vector<Continuation::Point> points(const std::vector<double> &p1Values, const std::vector<double> &p2Values, bool bothWays);
+
+	/**
+	 *\brief Runs the scan and writes one line per point to the summary table.
+	 *\param model model to scan, left in the state reached at the last point.
+	 *\param generator random number generator.
+	 *\param points points to visit in order.
+	 *\param out std::ostream reference for the summary table.
+	 *
+	 * The table has columns point, direction (1 forwards, -1 on the return), p_1, p_2, then the mean
+	 * and naive error of the red, green and blue fractions and finally 1 if the model is absorbed.
+	 */
+	void run(ConsensusModel &model, std::default_random_engine &generator, const std::vector<Continuation::Point> &points, std::ostream &out) const;
+};
+
+#endif /* Continuation_hpp */
@@ -0,0 +1,46 @@
+#include "CorrelationObservable.hpp"
+
+CorrelationObservable::CorrelationObservable(long long maxDistance) :
+	m_maxDistance{maxDistance}
+{
+
+}
+
+std::vector<double> CorrelationObservable::measure(const ConsensusArray &lattice) const
+{
+	long long rows = lattice.getRows();
+	long long cols = lattice.getCols();
+	const ConsensusModel::State *cells = lattice.getStorage().data();
+
+	long long counts[ConsensusModel::MAXSTATE] = {0, 0, 0};
+	std::vector<long long> matches(static_cast<std::size_t>(m_maxDistance + 1), 0);
+	for(long long row = 0; row < rows; ++row)
+	{
+		for(long long col = 0; col < cols; ++col)
+		{
+			ConsensusModel::State state = cells[lattice.index(row, col)];
+			++counts[state];
+
+			for(long long distance = 1; distance <= m_maxDistance; ++distance)
+			{
+				matches[distance] += (cells[lattice.index(row, (col + distance) % cols)] == state);
+				matches[distance] += (cells[lattice.index((row + distance) % rows, col)] == state);
+			}
+		}
+	}
+
+	double size = static_cast<double>(rows * cols);
+	double uncorrelated = 0;
+	for(long long count : counts)
+	{
+		uncorrelated += (count / size) * (count / size);
+	}
+
+	std::vector<double> correlation;
+	correlation.reserve(static_cast<std::size_t>(m_maxDistance));
+	for(long long distance = 1; distance <= m_maxDistance; ++distance)
+	{
+		correlation.push_back(matches[distance] / (2 * size) - uncorrelated);
+	}
+	return correlation;
+}
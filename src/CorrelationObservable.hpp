@@ -0,0 +1,36 @@
+#ifndef CorrelationObservable_hpp
+#define CorrelationObservable_hpp
+
+#include "MeasurementExecutor.hpp"
+
+/**
+ *\file
+ *\class CorrelationObservable
+ *\brief Observable giving the equal-state correlation function along the lattice axes.
+ *
+ * For each distance r from 1 to the maximum distance the value is the probability that two sites
+ * r apart along a row or column hold the same state, minus the probability for uncorrelated sites
+ * with the same fractions, so it decays to zero beyond the correlation length.
+ */
+class CorrelationObservable : public MeasurementExecutor::IObservable
+{
+private:
+	/// Member variable that holds the largest distance measured.
+	long long m_maxDistance;
+
+public:
+	/**
+	 *\brief Constructor.
+	 *\param maxDistance largest distance measured.
+	 */
+	explicit CorrelationObservable(long long maxDistance);
+
+	/**
+	 *\brief Measures the correlation function.
+	 *\param lattice snapshot of the lattice.
+	 *\return the correlation at each distance from 1 to the maximum distance.
+	 */
+	std::vector<double> measure(const ConsensusArray &lattice) const override;
+};
+
+#endif /* CorrelationObservable_hpp */
@@ -0,0 +1,40 @@
+#ifndef CounterRandom_hpp
+#define CounterRandom_hpp
+
+#include <cstdint> // For 64 bit unsigned arithmetic.
+
+/**
+ *\file
+ *\brief Counter-based random numbers: the n'th number of a stream is a pure function of (key, n).
+ *
+ * This is the SplitMix64 generator evaluated at an arbitrary position. Because nothing is carried
+ * from one number to the next, any thread can produce any part of a stream, the result does not
+ * depend on how work is split between threads, and a loop filling an array vectorises.
+ */
+
+/**
+ *\brief Returns the counter'th 64 bit random number of the stream identified by key.
+ *\param key identifies the stream, e.g. a seed drawn from a std::default_random_engine.
+ *\param counter position in the stream.
+ *\return 64 bit random number.
+ */
+inline std::uint64_t counterRandom(std::uint64_t key, std::uint64_t counter)
+{
+    std::uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ *\brief Maps 32 random bits to an integer in [0, range) without a division.
+ *\param bits 32 uniformly random bits.
+ *\param range number of possible values.
+ *\return Integer value in [0, range).
+ */
+inline std::uint32_t scaleRandom(std::uint32_t bits, std::uint32_t range)
+{
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(bits) * range) >> 32);
+}
+
+#endif /* CounterRandom_hpp */
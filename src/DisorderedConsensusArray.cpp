@@ -0,0 +1,196 @@
+#include "DisorderedConsensusArray.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <stdexcept>
+
+const std::uint8_t DisorderedConsensusArray::zealotFlag;
+const int DisorderedConsensusArray::classCount;
+
+DisorderedConsensusArray::DisorderedConsensusArray(
+	LatticeStorage &&storage,
+	long long rows,
+	long long cols,
+	double prob1,
+	double prob2,
+	ConsensusArray::Layout layout,
+	int tileSize) :
+	ConsensusArray(std::move(storage), rows, cols, prob1, prob2, layout, tileSize),
+	m_siteData(static_cast<std::size_t>(rows * cols), 0),
+	m_sites{m_siteData.data()},
+	m_classRates(classCount, std::make_pair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN()))
+{
+	buildAcceptance();
+}
+
+void DisorderedConsensusArray::buildAcceptance()
+{
+	for(int attributes = 0; attributes < 2 * classCount; ++attributes)
+	{
+		const std::pair<double, double> &rates = m_classRates[attributes & ~zealotFlag];
+		bool ownRates = (attributes & ~zealotFlag) != 0 && !std::isnan(rates.first);
+		double p1 = ownRates ? rates.first : getp1();
+		double p2 = ownRates ? rates.second : getp2();
+
+		for(int invader = 0; invader < MAXSTATE; ++invader)
+		{
+			for(int target = 0; target < MAXSTATE; ++target)
+			{
+				// Red invades green, green invades blue and blue invades red cyclically, the reverse anti-cyclically.
+				double probability = 0;
+				if(target == (invader + 1) % MAXSTATE)
+				{
+					probability = p1;
+				}
+				else if(target == (invader + 2) % MAXSTATE)
+				{
+					probability = p2;
+				}
+
+				m_acceptance[attributes][invader][target] = (attributes & zealotFlag) ? 0 : probability;
+			}
+		}
+	}
+}
+
+void DisorderedConsensusArray::ownSites()
+{
+	if(m_siteFile)
+	{
+		m_siteData.assign(m_sites, m_sites + getSize());
+		m_sites = m_siteData.data();
+		m_siteFile.reset();
+	}
+}
+
+void DisorderedConsensusArray::setClassRates(int rateClass, double prob1, double prob2)
+{
+	if(rateClass <= 0 || rateClass >= classCount)
+	{
+		throw std::invalid_argument("Rate classes with their own rates are 1 to 127");
+	}
+
+	m_classRates[rateClass] = std::make_pair(prob1, prob2);
+	buildAcceptance();
+}
+
+void DisorderedConsensusArray::setSite(long long row, long long col, int rateClass, bool zealot)
+{
+	ownSites();
+	m_siteData[index(row, col)] = static_cast<std::uint8_t>((rateClass & ~zealotFlag) | (zealot ? zealotFlag : 0));
+}
+
+int DisorderedConsensusArray::getSiteClass(long long row, long long col) const
+{
+	return m_sites[index(row, col)] & ~zealotFlag;
+}
+
+bool DisorderedConsensusArray::isZealot(long long row, long long col) const
+{
+	return (m_sites[index(row, col)] & zealotFlag) != 0;
+}
+
+void DisorderedConsensusArray::randomiseSites(std::default_random_engine &generator, const std::vector<double> &classFractions, double zealotFraction, int threadCount)
+{
+	if(classFractions.size() >= classCount)
+	{
+		throw std::invalid_argument("Too many rate classes");
+	}
+	ownSites();
+
+	// The low 32 bits of each number pick the class from cumulative thresholds, the high 32 bits the zealot flag.
+	const double scale = 4294967296.0;
+	std::vector<std::uint64_t> thresholds;
+	double cumulative = 0;
+	for(double fraction : classFractions)
+	{
+		cumulative += fraction;
+		thresholds.push_back(static_cast<std::uint64_t>(scale * std::min(1.0, cumulative)));
+	}
+	std::uint64_t zealotThreshold = static_cast<std::uint64_t>(scale * zealotFraction);
+
+	std::uniform_int_distribution<std::uint64_t> keyDistribution;
+	std::uint64_t key = keyDistribution(generator);
+	std::uint8_t *sites = m_siteData.data();
+	int threads = threadCount > 0 ? threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+	// Attributes are independent of position, so they are drawn in storage order whatever the layout.
+	parallelFor(threads, getSize(), 1LL << 18, [&](int, long long begin, long long end) {
+		for(long long site = begin; site < end; ++site)
+		{
+			std::uint64_t bits = counterRandom(key, static_cast<std::uint64_t>(site));
+			std::uint64_t classBits = bits & 0xFFFFFFFFULL;
+
+			// Class 0 holds whatever the listed classes leave over, so it is picked last.
+			int rateClass = 0;
+			for(std::size_t listed = 0; listed < thresholds.size(); ++listed)
+			{
+				if(classBits < thresholds[listed])
+				{
+					rateClass = static_cast<int>(listed) + 1;
+					break;
+				}
+			}
+
+			sites[site] = static_cast<std::uint8_t>(rateClass | ((bits >> 32) < zealotThreshold ? zealotFlag : 0));
+		}
+	});
+}
+
+void DisorderedConsensusArray::loadSites(const std::string &fileName)
+{
+	std::unique_ptr<MappedFile> siteFile(new MappedFile(fileName));
+	if(siteFile->size() != static_cast<std::size_t>(getSize()))
+	{
+		throw std::runtime_error("Site file " + fileName + " does not hold one byte per site");
+	}
+
+	m_siteFile = std::move(siteFile);
+	m_sites = reinterpret_cast<const std::uint8_t*>(m_siteFile->data());
+	std::vector<std::uint8_t>().swap(m_siteData);
+}
+
+long long DisorderedConsensusArray::zealotCount() const
+{
+	long long total = 0;
+	for(long long site = 0; site < getSize(); ++site)
+	{
+		total += (m_sites[site] & zealotFlag) != 0;
+	}
+	return total;
+}
+
+ConsensusArray::State DisorderedConsensusArray::update(std::default_random_engine& generator, long long row, long long col)
+{
+	// Draw the same numbers in the same order as ConsensusArray::update().
+	static std::uniform_int_distribution<int> neighbourDistribution(0,3);
+	long long neighbourRow = row;
+	long long neighbourCol = col;
+	moveToNeighbour(neighbourRow, neighbourCol, neighbourDistribution(generator));
+	long long neighbour = index(neighbourRow, neighbourCol);
+
+	static std::uniform_real_distribution<double> distribution(0.0,1.0);
+
+	const LatticeStorage &cells = getStorage();
+	ConsensusArray::State site = cells[index(row, col)];
+	ConsensusArray::State target = cells[neighbour];
+
+	// The target's attributes decide how readily it is invaded.
+	if(distribution(generator) < m_acceptance[m_sites[neighbour]][site][target])
+	{
+		changeState(neighbourRow, neighbourCol, neighbour, site);
+	}
+
+	return site;
+}
+
+void DisorderedConsensusArray::sweep(std::default_random_engine& generator)
+{
+	// Class 0 follows the lattice's rates, which may have been changed since the last sweep.
+	buildAcceptance();
+
+	sweepSchedule(generator, [this, &generator](long long row, long long col) { update(generator, row, col); });
+}
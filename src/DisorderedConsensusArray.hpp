@@ -0,0 +1,158 @@
+#ifndef DisorderedConsensusArray_hpp
+#define DisorderedConsensusArray_hpp
+
+#include <vector> // For the site attributes and class rates.
+#include <memory> // For owning a mapped site file.
+#include <string> // For file names.
+#include <cstdint> // For the site attribute bytes.
+#include "ConsensusArray.hpp"
+#include "MappedFile.hpp"
+
+/**
+ *\file
+ *\class DisorderedConsensusArray
+ *\brief Class for a 2D lattice with quenched disorder: site dependent invasion rates and zealots.
+ *
+ * Every site has one attribute byte, stored in the same order as the cells so that a site and its
+ * attributes are found with the same index. The low seven bits give the site's rate class and the
+ * top bit marks a zealot. When a cell tries to invade a neighbour the neighbour's class sets the
+ * p_1 and p_2 of the attempt, and a zealot is never invaded, though it still invades others.
+ * Class 0 always uses the lattice's own p_1 and p_2, other classes have rates of their own.
+ *
+ * The acceptance probability of every (attribute byte, invader, target) combination is looked up
+ * in one small table built at the start of each sweep, so a disordered update costs one extra
+ * byte load over a homogeneous one. A homogeneous lattice should still be a plain ConsensusArray,
+ * whose update is untouched.
+ */
+class DisorderedConsensusArray : public ConsensusArray
+{
+public:
+	/// Attribute bit marking a zealot.
+	static const std::uint8_t zealotFlag = 0x80;
+
+	/// Number of rate classes.
+	static const int classCount = 0x80;
+
+private:
+	/// Member variable that holds the attribute byte of each site when they are held in memory.
+	std::vector<std::uint8_t> m_siteData;
+
+	/// Member variable that holds the attribute file when the attributes are read from a mapping.
+	std::unique_ptr<MappedFile> m_siteFile;
+
+	/// Member variable that points at the attribute bytes, in memory or in the mapped file.
+	const std::uint8_t *m_sites;
+
+	/// Member variable that holds p_1 and p_2 of every class, class 0 follows the lattice.
+	std::vector<std::pair<double, double>> m_classRates;
+
+	/// Member variable that holds the acceptance probability indexed by attribute byte, invader and target state.
+	double m_acceptance[2 * classCount][MAXSTATE][MAXSTATE];
+
+	/**
+	 *\brief Rebuilds the acceptance table from the class rates and the lattice's p_1 and p_2.
+	 */
+	void buildAcceptance();
+
+	/**
+	 *\brief Makes the attributes writable by copying them out of a mapped file.
+	 */
+	void ownSites();
+
+public:
+	/**
+	 *\brief Constructor that takes over existing cells, with every site in class 0 and no zealots.
+	 *\param storage cells of the lattice, must hold rows*cols cells.
+	 *\param rows number of rows on the board.
+	 *\param cols number of columns on the board.
+	 *\param prob1 probability of a cyclic invasion of a class 0 site.
+	 *\param prob2 probability of an anti-cyclic invasion of a class 0 site.
+	 *\param layout memory layout of the cells, which the attributes share.
+	 *\param tileSize side of a tile in a tiled layout.
+	 */
+	DisorderedConsensusArray(
+		LatticeStorage &&storage,
+		long long rows,
+		long long cols,
+		double prob1 = 1.0,
+		double prob2 = 1.0,
+		ConsensusArray::Layout layout = ConsensusArray::RowMajor,
+		int tileSize = 64);
+
+	DisorderedConsensusArray(const DisorderedConsensusArray&) = delete;
+	DisorderedConsensusArray& operator=(const DisorderedConsensusArray&) = delete;
+
+	/**
+	 *\brief Sets the invasion probabilities of a rate class.
+	 *\param rateClass class in [1, classCount), class 0 follows setp1() and setp2().
+	 *\param prob1 probability of a cyclic invasion of a site in the class.
+	 *\param prob2 probability of an anti-cyclic invasion of a site in the class.
+	 */
+	void setClassRates(int rateClass, double prob1, double prob2);
+
+	/**
+	 *\brief Sets the attributes of a site.
+	 *\param row row index of site in [0, #rows).
+	 *\param col column index of site in [0, #columns).
+	 *\param rateClass class of the site in [0, classCount).
+	 *\param zealot true if the site can never be invaded.
+	 */
+	void setSite(long long row, long long col, int rateClass, bool zealot);
+
+	/**
+	 *\brief Getter for the rate class of a site.
+	 *\param row row index of site in [0, #rows).
+	 *\param col column index of site in [0, #columns).
+	 *\return Integer value representing the class.
+	 */
+	int getSiteClass(long long row, long long col) const;
+
+	/**
+	 *\brief Getter for whether a site is a zealot.
+	 *\param row row index of site in [0, #rows).
+	 *\param col column index of site in [0, #columns).
+	 *\return true if the site can never be invaded.
+	 */
+	bool isZealot(long long row, long long col) const;
+
+	/**
+	 *\brief Assigns every site a random class and zealot flag, in parallel from a counter-based stream.
+	 *\param generator std::default_random_engine reference the stream's key is drawn from.
+	 *\param classFractions fraction of sites in each of the classes 1, 2, ..., the rest are in class 0.
+	 *\param zealotFraction fraction of sites that are zealots, whatever their class.
+	 *\param threadCount number of threads, 0 uses every hardware thread.
+	 */
+	void randomiseSites(std::default_random_engine &generator, const std::vector<double> &classFractions, double zealotFraction, int threadCount = 0);
+
+	/**
+	 *\brief Maps the site attributes from a file of one byte per site in the lattice's storage order, without copying them.
+	 *
+	 * Throws std::runtime_error if the file cannot be opened or does not have one byte per site.
+	 *
+	 *\param fileName path of the attribute file.
+	 */
+	void loadSites(const std::string &fileName);
+
+	/**
+	 *\brief Counts the zealots.
+	 *\return Integer value representing the number of zealot sites.
+	 */
+	long long zealotCount() const;
+
+	/**
+	 *\brief Updates a given cell, it tries to invade one of its four neighbours at random at the neighbour's rates.
+	 *\param generator std::default_random_engine reference for random number generation.
+	 *\param row row index of site in [0, #rows).
+	 *\param col column index of site in [0, #columns).
+	 *\return the state of the cell.
+	 */
+	ConsensusArray::State update(std::default_random_engine& generator, long long row, long long col);
+
+	/**
+	 *\brief Performs one sweep in the same order as ConsensusArray::sweep() with disordered updates.
+	 *\param generator std::default_random_engine reference for random number generation.
+	 */
+	void sweep(std::default_random_engine& generator) override;
+};
+
+#endif /* DisorderedConsensusArray_hpp */
@@ -0,0 +1,234 @@
+#include "EnsembleDriver.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+	/// Replicas a point needs before its interval can stop it, so a lucky first batch cannot.
+	const long long minimumReplicas = 10;
+
+	/// Returns the quantile of sorted values by the nearest rank method.
+	double quantile(const std::vector<int> &sorted, double fraction)
+	{
+		if(sorted.empty())
+		{
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+
+		std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * sorted.size()));
+		return sorted[std::max<std::size_t>(rank, 1) - 1];
+	}
+}
+
+EnsembleDriver::EnsembleDriver(ModelFactory factory, int maxSweeps, int checkInterval, double targetHalfWidth, long long maxReplicas,
+	int threadCount, int batchSize, std::uint64_t seed, double confidence) :
+	m_factory{factory},
+	m_maxSweeps{maxSweeps},
+	m_checkInterval{checkInterval > 0 ? checkInterval : 1},
+	m_targetHalfWidth{targetHalfWidth},
+	m_z{0},
+	m_minReplicas{std::min(minimumReplicas, maxReplicas)},
+	m_maxReplicas{maxReplicas},
+	m_batchSize{batchSize > 0 ? batchSize : 4 * std::max(1, threadCount)},
+	m_threadCount{std::max(1, threadCount)},
+	m_seed{seed}
+{
+	// Solve erf(z / sqrt(2)) = confidence for the two sided z value by bisection.
+	double lower = 0;
+	double upper = 10;
+	for(int iteration = 0; iteration < 100; ++iteration)
+	{
+		m_z = 0.5 * (lower + upper);
+		(std::erf(m_z / std::sqrt(2.0)) < confidence ? lower : upper) = m_z;
+	}
+}
+
+double EnsembleDriver::halfWidth(long long successes, long long trials) const
+{
+	if(0 == trials)
+	{
+		return 1;
+	}
+
+	double n = static_cast<double>(trials);
+	double p = successes / n;
+	double zSquared = m_z * m_z;
+	return m_z / (1 + zSquared / n) * std::sqrt(p * (1 - p) / n + zSquared / (4 * n * n));
+}
+
+int EnsembleDriver::runReplica(std::size_t point, long long replica) const
+{
+	std::uint64_t stream = (static_cast<std::uint64_t>(point) << 40) + static_cast<std::uint64_t>(replica);
+	// Every bit of the replica's stream goes into the seed, rather than a 32 bit fold of it.
+	std::uint64_t bits = counterRandom(m_seed, stream);
+	std::seed_seq seeds{static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits)};
+	std::default_random_engine generator(seeds);
+
+	std::unique_ptr<ConsensusModel> model = m_factory(generator, m_estimates[point].p1, m_estimates[point].p2);
+	for(int sweep = 1; sweep <= m_maxSweeps; ++sweep)
+	{
+		model->sweep(generator);
+
+		if((0 == sweep%m_checkInterval || sweep == m_maxSweeps) && model->isAbsorbed())
+		{
+			return sweep;
+		}
+	}
+
+	return -1;
+}
+
+void EnsembleDriver::run(const std::vector<double> &p1Values, const std::vector<double> &p2Values, std::ostream &progress)
+{
+	if(p1Values.size() != p2Values.size())
+	{
+		throw std::invalid_argument("EnsembleDriver needs a value of p_1 for every value of p_2");
+	}
+
+	m_estimates.clear();
+	for(std::size_t point = 0; point < p2Values.size(); ++point)
+	{
+		m_estimates.push_back(Estimate{p1Values[point], p2Values[point], 0, 0, {}});
+	}
+
+	while(true)
+	{
+		// Hand out the batch one replica at a time to the point whose interval would stay widest.
+		std::vector<long long> pending(m_estimates.size(), 0);
+		std::vector<std::pair<std::size_t, long long>> batch;
+		for(int slot = 0; slot < m_batchSize; ++slot)
+		{
+			double widest = -1;
+			std::size_t chosen = m_estimates.size();
+			for(std::size_t point = 0; point < m_estimates.size(); ++point)
+			{
+				const Estimate &estimate = m_estimates[point];
+				bool converged = estimate.replicas >= m_minReplicas && halfWidth(estimate.absorbed, estimate.replicas) <= m_targetHalfWidth;
+				long long trials = estimate.replicas + pending[point];
+				if(converged || trials >= m_maxReplicas)
+				{
+					continue;
+				}
+
+				// Points below the minimum come first, otherwise project the interval with the current estimate.
+				double width = 2.0 - trials / static_cast<double>(m_minReplicas);
+				if(trials >= m_minReplicas)
+				{
+					double probability = static_cast<double>(estimate.absorbed) / estimate.replicas;
+					width = halfWidth(std::llround(probability * (trials + 1)), trials + 1);
+				}
+				if(width > widest)
+				{
+					widest = width;
+					chosen = point;
+				}
+			}
+
+			if(chosen == m_estimates.size())
+			{
+				break;
+			}
+			batch.emplace_back(chosen, m_estimates[chosen].replicas + pending[chosen]);
+			++pending[chosen];
+		}
+
+		if(batch.empty())
+		{
+			return;
+		}
+
+		// Replicas that are absorbed early finish orders of magnitude sooner than those that run to the
+		// limit, so each thread takes the next replica when it is free rather than a fixed block.
+		std::vector<int> times(batch.size());
+		std::atomic<long long> nextReplica(0);
+		long long batchSize = static_cast<long long>(batch.size());
+		parallelFor(m_threadCount, m_threadCount, 1, [this, &batch, &times, &nextReplica, batchSize](int, long long, long long)
+		{
+			for(long long replica = nextReplica++; replica < batchSize; replica = nextReplica++)
+			{
+				times[replica] = runReplica(batch[replica].first, batch[replica].second);
+			}
+		});
+
+		for(std::size_t replica = 0; replica < batch.size(); ++replica)
+		{
+			Estimate &estimate = m_estimates[batch[replica].first];
+			++estimate.replicas;
+			if(times[replica] >= 0)
+			{
+				++estimate.absorbed;
+				estimate.consensusTimes.push_back(times[replica]);
+			}
+		}
+
+		long long total = 0;
+		double widest = 0;
+		for(const auto &estimate : m_estimates)
+		{
+			total += estimate.replicas;
+			widest = std::max(widest, halfWidth(estimate.absorbed, estimate.replicas));
+		}
+		progress << "replicas " << total << ", widest interval +/- " << widest << std::endl;
+	}
+}
+
+const std::vector<EnsembleDriver::Estimate>& EnsembleDriver::getEstimates() const
+{
+	return m_estimates;
+}
+
+void EnsembleDriver::writeSummary(std::ostream &out) const
+{
+	for(const auto &estimate : m_estimates)
+	{
+		std::vector<int> sorted(estimate.consensusTimes);
+		std::sort(sorted.begin(), sorted.end());
+
+		double probability = estimate.replicas > 0 ? static_cast<double>(estimate.absorbed) / estimate.replicas : 0;
+		double width = halfWidth(estimate.absorbed, estimate.replicas);
+
+		// The Wilson interval is centred on a shrunk estimate rather than the plain fraction.
+		double n = static_cast<double>(std::max(1LL, estimate.replicas));
+		double centre = (probability + m_z * m_z / (2 * n)) / (1 + m_z * m_z / n);
+
+		double meanTime = sorted.empty() ? std::numeric_limits<double>::quiet_NaN() : 0;
+		for(int time : sorted)
+		{
+			meanTime += static_cast<double>(time) / sorted.size();
+		}
+
+		out << estimate.p1 << ' ' << estimate.p2 << ' ' << estimate.replicas << ' ' << estimate.absorbed << ' '
+		    << probability << ' ' << std::max(0.0, centre - width) << ' ' << std::min(1.0, centre + width) << ' ' << meanTime;
+		for(double fraction : {0.1, 0.25, 0.5, 0.75, 0.9})
+		{
+			out << ' ' << quantile(sorted, fraction);
+		}
+		out << '\n';
+	}
+}
+
+void EnsembleDriver::writeHistograms(std::ostream &out, int binCount) const
+{
+	binCount = std::max(1, binCount);
+	double binWidth = static_cast<double>(m_maxSweeps) / binCount;
+
+	for(const auto &estimate : m_estimates)
+	{
+		std::vector<long long> counts(static_cast<std::size_t>(binCount), 0);
+		for(int time : estimate.consensusTimes)
+		{
+			++counts[std::min(binCount - 1, static_cast<int>(time / binWidth))];
+		}
+
+		for(int bin = 0; bin < binCount; ++bin)
+		{
+			out << estimate.p1 << ' ' << estimate.p2 << ' ' << bin * binWidth << ' ' << (bin + 1) * binWidth << ' ' << counts[bin] << '\n';
+		}
+		out << "\n\n";
+	}
+}
@@ -0,0 +1,149 @@
+#ifndef EnsembleDriver_hpp
+#define EnsembleDriver_hpp
+
+#include <vector> // For points, estimates and consensus times.
+#include <memory> // For owning replicas.
+#include <random> // For the replica generators.
+#include <functional> // For the model factory.
+#include <iostream> // For the output tables.
+#include <cstdint> // For the seed.
+#include "ConsensusModel.hpp"
+
+/**
+ *\file
+ *\class EnsembleDriver
+ *\brief Class that estimates the probability of reaching consensus, and the time it takes, by adaptively sampled replicas.
+ *
+ * Each replica is a fresh model run until it is absorbed or a maximum number of sweeps has passed.
+ * Replicas are run in batches, each thread taking the next replica of the batch as soon as it is
+ * free, and after each batch the Wilson score interval of
+ * every point's absorbing probability is updated. A point stops receiving replicas once the half
+ * width of its interval is below the target, and each batch goes to the points whose intervals
+ * would remain widest, so points near a transition get most of the work and clear cut points very
+ * little.
+ *
+ * Every replica seeds its own generator, through a std::seed_seq of all 64 bits of a counter based
+ * random number, from the driver's seed, the point and the replica number, and
+ * the allocation only depends on completed batches, so results do not depend on the number of threads.
+ */
+class EnsembleDriver
+{
+public:
+	/// Creates a freshly initialised model for the given probabilities.
+	typedef std::function<std::unique_ptr<ConsensusModel>(std::default_random_engine &generator, double p1, double p2)> ModelFactory;
+
+	/**
+	 *\struct Estimate
+	 *\brief Running estimate for one parameter point.
+	 */
+	struct Estimate
+	{
+		/// Probability of a cyclic invasion.
+		double p1;
+		/// Probability of an anti-cyclic invasion.
+		double p2;
+		/// Number of replicas run.
+		long long replicas;
+		/// Number of replicas that reached consensus.
+		long long absorbed;
+		/// Sweep at which each absorbed replica reached consensus.
+		std::vector<int> consensusTimes;
+	};
+
+private:
+	/// Member variable that creates replicas.
+	ModelFactory m_factory;
+
+	/// Member variable that holds the maximum sweeps of a replica.
+	int m_maxSweeps;
+
+	/// Member variable that holds the sweeps between checks for consensus.
+	int m_checkInterval;
+
+	/// Member variable that holds the target half width of the confidence interval.
+	double m_targetHalfWidth;
+
+	/// Member variable that holds the z value of the confidence interval.
+	double m_z;
+
+	/// Member variable that holds the minimum replicas of a point before its interval is trusted.
+	long long m_minReplicas;
+
+	/// Member variable that holds the maximum replicas of a point.
+	long long m_maxReplicas;
+
+	/// Member variable that holds the number of replicas in a batch.
+	int m_batchSize;
+
+	/// Member variable that holds the number of threads.
+	int m_threadCount;
+
+	/// Member variable that holds the seed every replica's generator is derived from.
+	std::uint64_t m_seed;
+
+	/// Member variable that holds the estimate of each point.
+	std::vector<Estimate> m_estimates;
+
+	/**
+	 *\brief Half width of the Wilson score interval.
+	 *\param successes number of absorbed replicas.
+	 *\param trials number of replicas.
+	 *\return the half width, 1 when there are no trials.
+	 */
+	double halfWidth(long long successes, long long trials) const;
+
+	/**
+	 *\brief Runs one replica.
+	 *\param point index of the point.
+	 *\param replica number of the replica at that point.
+	 *\return the sweep at which the replica was absorbed, or -1 if it was not.
+	 */
+	int runReplica(std::size_t point, long long replica) const;
+
+public:
+	/**
+	 *\brief Constructor.
+	 *\param factory creates each replica.
+	 *\param maxSweeps sweeps after which a replica that has not reached consensus is stopped.
+	 *\param checkInterval sweeps between checks for consensus, which sets the resolution of consensus times.
+	 *\param targetHalfWidth half width of the confidence interval at which a point stops.
+	 *\param maxReplicas replicas after which a point stops regardless.
+	 *\param threadCount number of threads running replicas.
+	 *\param batchSize replicas per batch, 0 uses four per thread.
+	 *\param seed seed of the replica generators.
+	 *\param confidence confidence level of the intervals.
+	 */
+	EnsembleDriver(ModelFactory factory, int maxSweeps, int checkInterval, double targetHalfWidth, long long maxReplicas,
+		int threadCount, int batchSize, std::uint64_t seed, double confidence = 0.95);
+
+	/**
+	 *\brief Samples every point until it reaches the target precision or the replica limit.
+	 *\param p1Values values of p_1, one per point.
+	 *\param p2Values values of p_2, one per point.
+	 *\param progress stream a line is written to after each batch.
+	 */
+	void run(const std::vector<double> &p1Values, const std::vector<double> &p2Values, std::ostream &progress);
+
+	/**
+	 *\brief Getter for the estimates.
+	 *\return the estimate of each point, in the order given to run().
+	 */
+	const std::vector<EnsembleDriver::Estimate>& getEstimates() const;
+
+	/**
+	 *\brief Writes one line per point: p_1, p_2, replicas, absorbed, probability and its interval, then the mean
+	 * consensus time and its 10%, 25%, 50%, 75% and 90% quantiles (over the absorbed replicas).
+	 *\param out std::ostream reference for the table.
+	 */
+	void writeSummary(std::ostream &out) const;
+
+	/**
+	 *\brief Writes a histogram of consensus times for each point as a block of "p_1 p_2 start end count" lines,
+	 * blocks separated by two blank lines so gnuplot can select them with index.
+	 *\param out std::ostream reference for the histograms.
+	 *\param binCount number of bins spanning [0, maximum sweeps].
+	 */
+	void writeHistograms(std::ostream &out, int binCount) const;
+};
+
+#endif /* EnsembleDriver_hpp */
@@ -0,0 +1,7 @@
+#include "FractionObservable.hpp"
+
+std::vector<double> FractionObservable::measure(const ConsensusArray &lattice) const
+{
+	// The lattice tracks its species counts, so a snapshot carries them with no pass over the cells.
+	return {lattice.stateFraction(ConsensusModel::Red), lattice.stateFraction(ConsensusModel::Green), lattice.stateFraction(ConsensusModel::Blue)};
+}
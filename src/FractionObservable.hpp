@@ -0,0 +1,28 @@
+#ifndef FractionObservable_hpp
+#define FractionObservable_hpp
+
+#include "MeasurementExecutor.hpp"
+
+/**
+ *\file
+ *\class FractionObservable
+ *\brief Observable giving the fraction of red, green and blue sites, read from the tracked counts.
+ */
+class FractionObservable : public MeasurementExecutor::IObservable
+{
+public:
+	/**
+	 *\brief Measures the fractions from the counts the lattice tracks.
+	 *\param lattice the lattice, or a snapshot of it.
+	 *\return the red, green and blue fractions.
+	 */
+	std::vector<double> measure(const ConsensusArray &lattice) const override;
+
+	/**
+	 *\brief Only the tracked counts are read, so the lattice is measured in place.
+	 *\return false.
+	 */
+	bool readsCells() const override { return false; }
+};
+
+#endif /* FractionObservable_hpp */
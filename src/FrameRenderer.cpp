@@ -0,0 +1,151 @@
+#include "FrameRenderer.hpp"
+#include "ParallelFor.hpp"
+#include "PhaseProfiler.hpp"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+FrameRenderer::FrameRenderer(const std::string &directory, long long blockSize, int threadCount, std::size_t poolSize) :
+	m_directory{directory},
+	m_blockSize{blockSize > 0 ? blockSize : 1},
+	m_threadCount{threadCount > 0 ? threadCount : 1},
+	m_pool(poolSize),
+	m_finished{false},
+	m_worker(&FrameRenderer::run, this)
+{
+
+}
+
+FrameRenderer::~FrameRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finished = true;
+	}
+	m_queued.notify_one();
+	m_worker.join();
+}
+
+void FrameRenderer::submit(const ConsensusArray &lattice, int sweep)
+{
+	// A mapped lattice may not fit in memory even once, so it is rendered in place before the sweeps carry on.
+	if(lattice.getStorage().isMapped())
+	{
+		write(lattice, sweep, m_pixels);
+		return;
+	}
+
+	// Taking the snapshot blocks if the renderer is too far behind.
+	ConsensusArray *snapshot = m_pool.take(lattice);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(Frame{sweep, snapshot});
+	}
+	m_queued.notify_one();
+}
+
+void FrameRenderer::run()
+{
+	std::vector<std::uint8_t> pixels;
+
+	while(true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queued.wait(lock, [this]() { return m_finished || !m_queue.empty(); });
+
+			// Only stop once every submitted frame has been written.
+			if(m_queue.empty())
+			{
+				return;
+			}
+
+			frame = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		// Rendered while the sweeps continue, so counted in its own phase when profiling.
+		PhaseProfiler::ThreadScope scope(PhaseProfiler::Output);
+		write(*frame.snapshot, frame.sweep, pixels);
+		m_pool.release(frame.snapshot);
+	}
+}
+
+void FrameRenderer::write(const ConsensusArray &lattice, int sweep, std::vector<std::uint8_t> &pixels) const
+{
+	long long width;
+	long long height;
+	render(lattice, m_blockSize, m_threadCount, pixels, width, height);
+
+	std::stringstream fileName;
+	fileName << m_directory << "/frame_" << std::setw(8) << std::setfill('0') << sweep << ".ppm";
+	std::fstream imageOutput(fileName.str(), std::ios::out | std::ios::binary);
+	writePPM(imageOutput, pixels, width, height);
+}
+
+void FrameRenderer::render(const ConsensusArray &lattice, long long blockSize, int threadCount,
+	std::vector<std::uint8_t> &pixels, long long &width, long long &height)
+{
+	long long rows = lattice.getRows();
+	long long cols = lattice.getCols();
+	width  = (cols + blockSize - 1) / blockSize;
+	height = (rows + blockSize - 1) / blockSize;
+	pixels.resize(static_cast<std::size_t>(width * height * 3));
+
+	// Cells along a row are contiguous for a whole row major row or for a tile side when tiled.
+	long long run = (ConsensusArray::RowMajor == lattice.getLayout()) ? cols : lattice.getTileSize();
+	const ConsensusModel::State *data = lattice.getStorage().data();
+	std::uint8_t *image = pixels.data();
+
+	// Each thread renders whole rows of pixels so no two threads write the same pixel.
+	parallelFor(threadCount, height, 1, [=](int, long long firstPixelRow, long long lastPixelRow) {
+		std::vector<long long> counts(static_cast<std::size_t>(width * ConsensusModel::MAXSTATE));
+
+		for(long long pixelRow = firstPixelRow; pixelRow < lastPixelRow; ++pixelRow)
+		{
+			std::fill(counts.begin(), counts.end(), 0);
+
+			long long firstRow = pixelRow * blockSize;
+			long long lastRow = std::min(rows, firstRow + blockSize);
+			for(long long row = firstRow; row < lastRow; ++row)
+			{
+				for(long long firstCol = 0; firstCol < cols; firstCol += run)
+				{
+					const ConsensusModel::State *cells = data + lattice.index(row, firstCol);
+
+					// Step to the next pixel at each block edge rather than dividing for every cell.
+					long long pixel = firstCol / blockSize;
+					long long nextEdge = (pixel + 1) * blockSize - firstCol;
+					for(long long offset = 0; offset < run; ++offset)
+					{
+						if(offset == nextEdge)
+						{
+							++pixel;
+							nextEdge += blockSize;
+						}
+						++counts[pixel * ConsensusModel::MAXSTATE + cells[offset]];
+					}
+				}
+			}
+
+			std::uint8_t *out = image + pixelRow * width * 3;
+			for(long long pixel = 0; pixel < width; ++pixel)
+			{
+				const long long *blockCounts = &counts[pixel * ConsensusModel::MAXSTATE];
+				long long total = blockCounts[0] + blockCounts[1] + blockCounts[2];
+				for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+				{
+					out[3 * pixel + state] = static_cast<std::uint8_t>((255 * blockCounts[state] + total / 2) / total);
+				}
+			}
+		}
+	});
+}
+
+void FrameRenderer::writePPM(std::ostream &out, const std::vector<std::uint8_t> &pixels, long long width, long long height)
+{
+	out << "P6\n" << width << ' ' << height << "\n255\n";
+	out.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+}
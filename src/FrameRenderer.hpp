@@ -0,0 +1,131 @@
+#ifndef FrameRenderer_hpp
+#define FrameRenderer_hpp
+
+#include <string> // For the output directory.
+#include <vector> // For the image buffer.
+#include <deque> // For the queue of frames.
+#include <thread> // For rendering off the sweep thread.
+#include <mutex> // For guarding the queue.
+#include <condition_variable> // For waking the renderer.
+#include <cstdint> // For the pixel type.
+#include <iostream> // For writing images.
+#include "ConsensusArray.hpp"
+#include "LatticeSnapshotPool.hpp"
+
+/**
+ *\file
+ *\class FrameRenderer
+ *\brief Class that writes images of a lattice as binary PPM files on a background thread.
+ *
+ * Each pixel covers a square block of cells and its red, green and blue intensities are the
+ * fractions of red, green and blue cells in the block, so a 16k x 16k lattice with blocks of 16
+ * becomes a 1k x 1k picture of the local species mix. With blocks of 1 every cell is a pixel in
+ * the same colours as animate.gp.
+ *
+ * submit() only copies the lattice into a pooled snapshot and queues it, the coarse-graining (split
+ * over several threads) and file output happen on the renderer's own thread while the sweeps carry on.
+ * A lattice held in a mapped file is never copied: submit() renders it in place before returning.
+ */
+class FrameRenderer
+{
+private:
+	/// A queued frame.
+	struct Frame
+	{
+		/// Sweep the frame was taken at, used in the file name.
+		int sweep;
+		/// Snapshot of the lattice, owned by the pool.
+		ConsensusArray *snapshot;
+	};
+
+	/// Member variable that holds the directory frames are written to.
+	std::string m_directory;
+
+	/// Member variable that holds the side of the block of cells averaged into one pixel.
+	long long m_blockSize;
+
+	/// Member variable that holds the number of threads used to coarse-grain a frame.
+	int m_threadCount;
+
+	/// Member variable that holds the reusable snapshots.
+	LatticeSnapshotPool m_pool;
+
+	/// Member variable that holds the frames waiting to be rendered.
+	std::deque<Frame> m_queue;
+
+	/// Member variable that is true once no more frames will be submitted.
+	bool m_finished;
+
+	/// Member variable that guards the queue.
+	std::mutex m_mutex;
+
+	/// Member variable that is notified when a frame is queued or the renderer is finished.
+	std::condition_variable m_queued;
+
+	/// Member variable that holds the image buffer of frames rendered by submit().
+	std::vector<std::uint8_t> m_pixels;
+
+	/// Member variable that holds the rendering thread, declared last so it starts after everything else is ready.
+	std::thread m_worker;
+
+	/**
+	 *\brief Loop run by the rendering thread.
+	 */
+	void run();
+
+	/**
+	 *\brief Renders a lattice and writes it to the frame file of a sweep.
+	 *\param lattice lattice to render.
+	 *\param sweep sweep number used to name the file.
+	 *\param pixels image buffer reused between frames.
+	 */
+	void write(const ConsensusArray &lattice, int sweep, std::vector<std::uint8_t> &pixels) const;
+
+public:
+	/**
+	 *\brief Constructor that starts the rendering thread.
+	 *\param directory existing directory to write frame_<sweep>.ppm files into.
+	 *\param blockSize side of the block of cells averaged into one pixel.
+	 *\param threadCount number of threads used to coarse-grain each frame.
+	 *\param poolSize maximum number of frames waiting to be rendered before submit() blocks.
+	 */
+	FrameRenderer(const std::string &directory, long long blockSize = 1, int threadCount = 1, std::size_t poolSize = 2);
+
+	/**
+	 *\brief Destructor that renders every queued frame and stops the rendering thread.
+	 */
+	~FrameRenderer();
+
+	FrameRenderer(const FrameRenderer&) = delete;
+	FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+	/**
+	 *\brief Queues a frame of the lattice as it is now, or renders it at once if the lattice is mapped.
+	 *\param lattice lattice to render.
+	 *\param sweep sweep number used to name the file.
+	 */
+	void submit(const ConsensusArray &lattice, int sweep);
+
+	/**
+	 *\brief Coarse-grains a lattice into RGB pixels.
+	 *\param lattice lattice to render.
+	 *\param blockSize side of the block of cells averaged into one pixel.
+	 *\param threadCount number of threads to use.
+	 *\param pixels buffer resized to hold width*height*3 bytes.
+	 *\param width set to the width of the image.
+	 *\param height set to the height of the image.
+	 */
+	static void render(const ConsensusArray &lattice, long long blockSize, int threadCount,
+		std::vector<std::uint8_t> &pixels, long long &width, long long &height);
+
+	/**
+	 *\brief Writes RGB pixels as a binary PPM image.
+	 *\param out std::ostream reference opened in binary mode.
+	 *\param pixels width*height*3 bytes.
+	 *\param width width of the image.
+	 *\param height height of the image.
+	 */
+	static void writePPM(std::ostream &out, const std::vector<std::uint8_t> &pixels, long long width, long long height);
+};
+
+#endif /* FrameRenderer_hpp */
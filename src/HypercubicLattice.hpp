@@ -0,0 +1,269 @@
+#ifndef HypercubicLattice_hpp
+#define HypercubicLattice_hpp
+
+#include <vector> // For holding the data in the lattice.
+#include <array> // For coordinates and strides.
+#include <random> // For generating random numbers.
+#include <iostream> // For outputting slices of the lattice.
+#include <cstdint> // For the packed binary output.
+#include <algorithm> // For std::min.
+#include "ConsensusModel.hpp"
+
+/**
+ * \file
+ * \class HypercubicLattice
+ * \brief Class template to model a periodic D dimensional hypercubic lattice of side L in the
+ * Consensus model.
+ *
+ * Site (x_0, ..., x_{D-1}) is stored at index x_0 + x_1 L + ... + x_{D-1} L^{D-1}. The dimension
+ * is a template parameter so every loop over dimensions and the 2D neighbour choice are resolved
+ * at compile time, only the strides depend on the run time side length. An update draws each
+ * coordinate separately, exactly like ConsensusArray draws a row and a column, so moving to a
+ * neighbour only needs a compare against the edge of the lattice and never a division.
+ */
+template<int D>
+class HypercubicLattice : public ConsensusModel
+{
+    static_assert(D >= 1, "A lattice needs at least one dimension.");
+
+public:
+    /// Type used to hold the coordinates of a site.
+    using Coordinates = std::array<long long, D>;
+
+    /// Number of nearest neighbours of every site.
+    static constexpr int neighbourCount = 2 * D;
+
+private:
+    /// Member variable that holds the side length of the lattice.
+    long long m_length;
+
+    /// Member variable that holds the index stride of each dimension.
+    Coordinates m_strides;
+
+    /// Member variable that holds the actual data in the lattice.
+    std::vector<State> m_data;
+
+public:
+    /**
+     *\brief Constructor that randomises lattice to an even mix of states.
+     *\param generator std::default_random_engine reference for generating random numbers.
+     *\param length number of sites along each dimension.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     */
+    HypercubicLattice(
+        std::default_random_engine &generator,
+        long long length = 16,
+        double prob1 = 1.0,
+        double prob2 = 1.0
+        ) : ConsensusModel(prob1, prob2),
+            m_length{length}
+    {
+        long long stride = 1;
+        for(int dimension = 0; dimension < D; ++dimension)
+        {
+            m_strides[dimension] = stride;
+            stride *= m_length;
+        }
+
+        m_data.resize(stride);
+        randomise(generator);
+    }
+
+    /**
+     *\brief Randomises the cells with equal probability of being in each state.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void randomise(std::default_random_engine &generator)
+    {
+        static std::uniform_int_distribution<int> distribution(0,static_cast<int>(ConsensusModel::MAXSTATE)-1);
+
+        for(auto &cell : m_data)
+        {
+            cell = static_cast<ConsensusModel::State>(distribution(generator));
+        }
+    }
+
+    /**
+     *\brief Getter for the side length.
+     *\return Integer value representing the number of sites along each dimension.
+     */
+    long long getLength() const
+    {
+        return m_length;
+    }
+
+    /**
+     *\brief Getter for the number of sites, L^D.
+     *\return Integer value representing the size of the lattice.
+     */
+    long long getSize() const override
+    {
+        return static_cast<long long>(m_data.size());
+    }
+
+    /**
+     *\brief operator overload for getting the state at a site, coordinates must lie in [0, L).
+     *\param coordinates coordinates of the site.
+     *\return reference to state stored at site so caller can use it or set it.
+     */
+    State& operator()(const Coordinates &coordinates)
+    {
+        return m_data[index(coordinates)];
+    }
+
+    /**
+     *\brief constant version of non-constant counterpart.
+     *\param coordinates coordinates of the site.
+     *\return constant reference to state stored at site.
+     */
+    const State& operator()(const Coordinates &coordinates) const
+    {
+        return m_data[index(coordinates)];
+    }
+
+    /**
+     *\brief Calculates the 1D index of a site.
+     *\param coordinates coordinates of the site.
+     *\return Integer value representing the index into the data.
+     */
+    long long index(const Coordinates &coordinates) const
+    {
+        long long site = 0;
+        for(int dimension = 0; dimension < D; ++dimension)
+        {
+            site += coordinates[dimension] * m_strides[dimension];
+        }
+        return site;
+    }
+
+    /**
+     *\brief Updates a random cell: it tries to invade one of its 2D nearest neighbours.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\return the state of the chosen cell.
+     */
+    State update(std::default_random_engine &generator)
+    {
+        std::uniform_int_distribution<long long> coordinateDistribution(0, m_length - 1);
+        static std::uniform_int_distribution<int> neighbourDistribution(0, neighbourCount - 1);
+        static std::uniform_real_distribution<double> distribution(0.0,1.0);
+
+        Coordinates coordinates;
+        for(int dimension = 0; dimension < D; ++dimension)
+        {
+            coordinates[dimension] = coordinateDistribution(generator);
+        }
+        long long site = index(coordinates);
+
+        // The low bit of the neighbour selects the direction, the rest the dimension.
+        int neighbour = neighbourDistribution(generator);
+        int dimension = neighbour >> 1;
+        long long coordinate = coordinates[dimension];
+
+        // Periodic wrapping only needs a comparison with the edge of the lattice.
+        long long shifted = (neighbour & 1)
+            ? (coordinate + 1 == m_length ? 0 : coordinate + 1)
+            : (coordinate == 0 ? m_length - 1 : coordinate - 1);
+        long long neighbourSite = site + (shifted - coordinate) * m_strides[dimension];
+
+        if(distribution(generator) < getProbability(m_data[site], m_data[neighbourSite]))
+        {
+            m_data[neighbourSite] = m_data[site];
+        }
+
+        return m_data[site];
+    }
+
+    /**
+     *\brief Performs one sweep of the lattice, i.e. L^D random updates.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweep(std::default_random_engine &generator) override
+    {
+        long long size = getSize();
+        for(long long i = 0; i < size; ++i)
+        {
+            update(generator);
+        }
+    }
+
+    /**
+     *\brief calculates the total number of cells in a given state.
+     *\param state value representing the state of interest.
+     *\return Integer value representing the total number of cells in the state of interest.
+     */
+    long long stateCount(State state) const override
+    {
+        long long total = 0;
+        for(const auto &cell : m_data)
+        {
+            total += (cell == state);
+        }
+        return total;
+    }
+
+    /**
+     *\brief Prints a 2D slice in the same text format as ConsensusArray so it can be animated.
+     *
+     * The slice spans the first two dimensions with every other coordinate set to position.
+     *
+     *\param out std::ostream reference that is being streamed to.
+     *\param position coordinate of the slice along the remaining dimensions, in [0, length).
+     */
+    void writeSlice(std::ostream &out, long long position) const
+    {
+        Coordinates coordinates;
+        coordinates.fill(position);
+
+        long long rows = D > 1 ? m_length : 1;
+        for(long long row = 0; row < rows; ++row)
+        {
+            if(D > 1)
+            {
+                coordinates[1 % D] = row;
+            }
+            for(long long col = 0; col < m_length; ++col)
+            {
+                coordinates[0] = col;
+                out << static_cast<int>((*this)(coordinates)) << ' ';
+            }
+            out << '\n';
+        }
+    }
+
+    /**
+     *\brief Writes the whole lattice as one byte per site in storage order, dimension 0 fastest.
+     *\param out std::ostream reference that is being written to, should be opened in binary mode.
+     */
+    void writeBinary(std::ostream &out) const
+    {
+        // Convert to bytes a block at a time so the stream sees large writes.
+        const std::size_t blockSize = 1 << 16;
+        std::vector<std::uint8_t> block;
+        block.reserve(blockSize);
+
+        for(std::size_t first = 0; first < m_data.size(); first += blockSize)
+        {
+            std::size_t last = std::min(m_data.size(), first + blockSize);
+            block.assign(m_data.begin() + first, m_data.begin() + last);
+            out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+        }
+    }
+
+    /**
+     *\brief streams the slice through the origin to an output stream.
+     *\param out std::ostream reference that is being streamed to.
+     *\param lattice HypercubicLattice reference to be printed.
+     *\return std::ostream reference to output can be chained.
+     */
+    friend std::ostream& operator<<(std::ostream &out, const HypercubicLattice &lattice)
+    {
+        lattice.writeSlice(out, 0);
+        return out;
+    }
+};
+
+template<int D>
+constexpr int HypercubicLattice<D>::neighbourCount;
+
+#endif /* HypercubicLattice_hpp */
@@ -0,0 +1,205 @@
+#include "LatticeInitialiser.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	/// Least number of cells worth handing to a thread.
+	const long long cellGrain = 1LL << 18;
+}
+
+LatticeInitialiser::LatticeInitialiser(std::default_random_engine &generator, int threadCount) :
+	m_threadCount{threadCount > 0 ? threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))}
+{
+	std::uniform_int_distribution<std::uint64_t> keyDistribution;
+	m_key = keyDistribution(generator);
+}
+
+int LatticeInitialiser::getThreadCount() const
+{
+	return m_threadCount;
+}
+
+template<typename CellFunction>
+void LatticeInitialiser::fillRows(ConsensusArray &lattice, CellFunction cell) const
+{
+	long long rows = lattice.getRows();
+	long long cols = lattice.getCols();
+
+	// A row is stored contiguously in a row major layout and in runs of one tile side when tiled.
+	long long run = (ConsensusArray::RowMajor == lattice.getLayout()) ? cols : lattice.getTileSize();
+	ConsensusModel::State *data = lattice.getStorage().data();
+
+	parallelFor(m_threadCount, rows, std::max(1LL, cellGrain / std::max(1LL, cols)),
+		[&](int, long long firstRow, long long lastRow) {
+			for(long long row = firstRow; row < lastRow; ++row)
+			{
+				for(long long firstCol = 0; firstCol < cols; firstCol += run)
+				{
+					ConsensusModel::State *out = data + lattice.index(row, firstCol);
+					for(long long offset = 0; offset < run; ++offset)
+					{
+						out[offset] = cell(row, firstCol + offset);
+					}
+				}
+			}
+		});
+
+	lattice.recount();
+}
+
+void LatticeInitialiser::random(ConsensusArray &lattice) const
+{
+	const double fractions[ConsensusModel::MAXSTATE] = {1.0, 1.0, 1.0};
+	random(lattice, fractions);
+}
+
+void LatticeInitialiser::random(ConsensusArray &lattice, const double fractions[ConsensusModel::MAXSTATE]) const
+{
+	double total = fractions[ConsensusModel::Red] + fractions[ConsensusModel::Green] + fractions[ConsensusModel::Blue];
+
+	// A 32 bit number below the first threshold is red, below the second green, otherwise blue.
+	const double scale = 4294967296.0;
+	std::uint64_t redThreshold = static_cast<std::uint64_t>(scale * fractions[ConsensusModel::Red] / total);
+	std::uint64_t greenThreshold = static_cast<std::uint64_t>(scale * (fractions[ConsensusModel::Red] + fractions[ConsensusModel::Green]) / total);
+
+	// Cells are independent of their position so they are filled in storage order whatever the
+	// layout, two cells from each 64 bit number.
+	ConsensusModel::State *data = lattice.getStorage().data();
+	long long size = lattice.getSize();
+	long long words = (size + 1) / 2;
+	std::uint64_t key = m_key;
+
+	parallelFor(m_threadCount, words, cellGrain / 2, [=](int, long long firstWord, long long lastWord) {
+		auto state = [=](std::uint64_t bits) {
+			return static_cast<ConsensusModel::State>((bits >= redThreshold) + (bits >= greenThreshold));
+		};
+
+		long long fullWords = std::min(lastWord, size / 2);
+		for(long long word = firstWord; word < fullWords; ++word)
+		{
+			std::uint64_t bits = counterRandom(key, static_cast<std::uint64_t>(word));
+			data[2 * word]     = state(bits & 0xFFFFFFFFULL);
+			data[2 * word + 1] = state(bits >> 32);
+		}
+
+		// An odd sized lattice has one cell left over in the last word.
+		if(lastWord > fullWords)
+		{
+			data[size - 1] = state(counterRandom(key, static_cast<std::uint64_t>(size / 2)) & 0xFFFFFFFFULL);
+		}
+	});
+
+	lattice.recount();
+}
+
+void LatticeInitialiser::stripes(ConsensusArray &lattice, long long width, bool vertical) const
+{
+	if(width < 1)
+	{
+		throw std::invalid_argument("Stripe width must be at least one cell.");
+	}
+
+	fillRows(lattice, [=](long long row, long long col) {
+		return static_cast<ConsensusModel::State>(((vertical ? col : row) / width) % ConsensusModel::MAXSTATE);
+	});
+}
+
+void LatticeInitialiser::domains(ConsensusArray &lattice, long long domainSize) const
+{
+	if(domainSize < 1)
+	{
+		throw std::invalid_argument("Domain size must be at least one cell.");
+	}
+
+	long long domainsPerRow = (lattice.getCols() + domainSize - 1) / domainSize;
+	std::uint64_t key = m_key;
+
+	// The state of a domain only depends on its position, so no thread needs to know another's domains.
+	fillRows(lattice, [=](long long row, long long col) {
+		std::uint64_t domain = static_cast<std::uint64_t>((row / domainSize) * domainsPerRow + col / domainSize);
+		return static_cast<ConsensusModel::State>(scaleRandom(static_cast<std::uint32_t>(counterRandom(key, domain)), ConsensusModel::MAXSTATE));
+	});
+}
+
+void LatticeInitialiser::load(ConsensusArray &lattice, const std::string &fileName) const
+{
+	MappedFile file(fileName);
+
+	long long rows = lattice.getRows();
+	long long cols = lattice.getCols();
+
+	if(static_cast<long long>(file.size()) != rows * cols)
+	{
+		throw std::runtime_error(fileName + " does not hold one byte for each of the rows*cols cells.");
+	}
+
+	long long run = (ConsensusArray::RowMajor == lattice.getLayout()) ? cols : lattice.getTileSize();
+	ConsensusModel::State *data = lattice.getStorage().data();
+	const unsigned char *cells = reinterpret_cast<const unsigned char*>(file.data());
+	std::atomic<bool> valid(true);
+
+	parallelFor(m_threadCount, rows, std::max(1LL, cellGrain / std::max(1LL, cols)),
+		[&](int, long long firstRow, long long lastRow) {
+			unsigned char largest = 0;
+			for(long long row = firstRow; row < lastRow; ++row)
+			{
+				const unsigned char *in = cells + row * cols;
+				for(long long col = 0; col < cols; ++col)
+				{
+					largest = std::max(largest, in[col]);
+				}
+
+				for(long long firstCol = 0; firstCol < cols; firstCol += run)
+				{
+					std::memcpy(data + lattice.index(row, firstCol), in + firstCol, static_cast<std::size_t>(run));
+				}
+			}
+
+			if(largest >= ConsensusModel::MAXSTATE)
+			{
+				valid = false;
+			}
+		});
+
+	if(!valid)
+	{
+		throw std::runtime_error(fileName + " contains a cell that is not 0, 1 or 2.");
+	}
+
+	lattice.recount();
+}
+
+void LatticeInitialiser::keep(ConsensusArray &lattice) const
+{
+	const ConsensusModel::State *data = lattice.getStorage().data();
+	long long size = lattice.getSize();
+	std::atomic<bool> valid(true);
+
+	// The cells are read in storage order whatever the layout, the first pass over a mapped file pages it in.
+	parallelFor(m_threadCount, size, cellGrain,
+		[&](int, long long first, long long last) {
+			unsigned char largest = 0;
+			for(long long cell = first; cell < last; ++cell)
+			{
+				largest = std::max(largest, static_cast<unsigned char>(data[cell]));
+			}
+
+			if(largest >= ConsensusModel::MAXSTATE)
+			{
+				valid = false;
+			}
+		});
+
+	if(!valid)
+	{
+		throw std::runtime_error("The lattice to keep contains a cell that is not 0, 1 or 2.");
+	}
+
+	lattice.recount();
+}
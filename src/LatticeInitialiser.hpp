@@ -0,0 +1,102 @@
+#ifndef LatticeInitialiser_hpp
+#define LatticeInitialiser_hpp
+
+#include <random> // For seeding the streams.
+#include <string> // For lattice file names.
+#include <cstdint> // For the stream key.
+#include "ConsensusArray.hpp"
+
+/**
+ *\file
+ *\class LatticeInitialiser
+ *\brief Class that fills a lattice with an initial condition using several threads.
+ *
+ * Random cells come from a counter-based stream (see CounterRandom.hpp) keyed by one number drawn
+ * from the caller's generator, so every thread generates its own part of the lattice independently,
+ * the inner loops vectorise and the lattice is the same whatever the number of threads. The fill
+ * is the first write to freshly allocated cells, so each thread also first touches the memory it
+ * fills.
+ */
+class LatticeInitialiser
+{
+private:
+	/// Member variable that holds the key of the random stream.
+	std::uint64_t m_key;
+
+	/// Member variable that holds the maximum number of threads to use.
+	int m_threadCount;
+
+	/**
+	 *\brief Fills every row of the lattice in parallel.
+	 *\param lattice lattice to fill.
+	 *\param cell callable returning the state of the cell at (row, col).
+	 */
+	template<typename CellFunction>
+	void fillRows(ConsensusArray &lattice, CellFunction cell) const;
+
+public:
+	/**
+	 *\brief Constructor that draws the key of the random stream from a generator.
+	 *\param generator std::default_random_engine reference for random number generation.
+	 *\param threadCount maximum number of threads to use, 0 uses every hardware thread.
+	 */
+	LatticeInitialiser(std::default_random_engine &generator, int threadCount = 0);
+
+	/**
+	 *\brief Getter for the maximum number of threads used.
+	 *\return Integer value representing the number of threads.
+	 */
+	int getThreadCount() const;
+
+	/**
+	 *\brief Sets every cell to an independent random state with equal probability of each.
+	 *\param lattice lattice to fill.
+	 */
+	void random(ConsensusArray &lattice) const;
+
+	/**
+	 *\brief Sets every cell to an independent random state with the given probabilities.
+	 *\param lattice lattice to fill.
+	 *\param fractions expected fraction of red, green and blue cells, normalised if they do not sum to one.
+	 */
+	void random(ConsensusArray &lattice, const double fractions[ConsensusModel::MAXSTATE]) const;
+
+	/**
+	 *\brief Fills the lattice with stripes cycling through red, green and blue.
+	 *\param lattice lattice to fill.
+	 *\param width width of each stripe in cells.
+	 *\param vertical true for stripes running along the columns, false for along the rows.
+	 */
+	void stripes(ConsensusArray &lattice, long long width, bool vertical = true) const;
+
+	/**
+	 *\brief Fills the lattice with square domains, each of a single random state.
+	 *\param lattice lattice to fill.
+	 *\param domainSize side of each domain in cells.
+	 */
+	void domains(ConsensusArray &lattice, long long domainSize) const;
+
+	/**
+	 *\brief Loads the lattice from a memory-mapped file of one byte per cell in row major order.
+	 *
+	 * The cells are rearranged into the lattice's layout. This is the format of Lattice.bin and of
+	 * the file written by --mmap-file with a row major layout, but not with a tiled one, which is
+	 * stored tile by tile and is resumed with keep() instead. Throws std::runtime_error if the size
+	 * or any cell is wrong.
+	 *
+	 *\param lattice lattice to fill.
+	 *\param fileName path of the lattice file.
+	 */
+	void load(ConsensusArray &lattice, const std::string &fileName) const;
+
+	/**
+	 *\brief Keeps the cells the lattice already holds, such as a mapped file from an earlier run, and counts them.
+	 *
+	 * Throws std::runtime_error if any cell is not a state, as happens when the file was never written.
+	 *
+	 *\param lattice lattice to check and count.
+	 */
+	void keep(ConsensusArray &lattice) const;
+};
+
+#endif /* LatticeInitialiser_hpp */
@@ -0,0 +1,39 @@
+#include "LatticeSnapshotPool.hpp"
+
+LatticeSnapshotPool::LatticeSnapshotPool(std::size_t capacity) : m_capacity{capacity > 0 ? capacity : 1}
+{
+
+}
+
+ConsensusArray* LatticeSnapshotPool::take(const ConsensusArray &lattice)
+{
+	ConsensusArray *snapshot = nullptr;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// Allocate a new snapshot only while under capacity and nothing can be reused.
+		if(m_free.empty() && m_snapshots.size() < m_capacity)
+		{
+			m_snapshots.emplace_back(new ConsensusArray(lattice));
+			return m_snapshots.back().get();
+		}
+
+		m_released.wait(lock, [this]() { return !m_free.empty(); });
+		snapshot = m_free.back();
+		m_free.pop_back();
+	}
+
+	// Copy outside the lock, assigning a lattice of the same size reuses the cells.
+	*snapshot = lattice;
+	return snapshot;
+}
+
+void LatticeSnapshotPool::release(ConsensusArray *snapshot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_free.push_back(snapshot);
+	}
+	m_released.notify_one();
+}
@@ -0,0 +1,59 @@
+#ifndef LatticeSnapshotPool_hpp
+#define LatticeSnapshotPool_hpp
+
+#include <vector> // For holding the snapshots.
+#include <memory> // For owning the snapshots.
+#include <mutex> // For sharing the pool between threads.
+#include <condition_variable> // For waiting on a free snapshot.
+#include "ConsensusArray.hpp"
+
+/**
+ *\file
+ *\class LatticeSnapshotPool
+ *\brief Class that hands out reusable copies of a lattice so it can be processed off the sweep thread.
+ *
+ * A snapshot is allocated the first time it is needed and afterwards each new snapshot is copied
+ * into a released one, so taking a snapshot is a single memcpy of the cells with no allocation. At
+ * most a fixed number of snapshots exist, when they are all in use take() blocks until one is
+ * released, which stops a slow consumer from letting memory grow without bound.
+ */
+class LatticeSnapshotPool
+{
+private:
+	/// Member variable that owns every snapshot that has been allocated.
+	std::vector<std::unique_ptr<ConsensusArray>> m_snapshots;
+
+	/// Member variable that holds the snapshots not currently in use.
+	std::vector<ConsensusArray*> m_free;
+
+	/// Member variable that holds the maximum number of snapshots.
+	std::size_t m_capacity;
+
+	/// Member variable that guards the pool.
+	std::mutex m_mutex;
+
+	/// Member variable that is notified whenever a snapshot is released.
+	std::condition_variable m_released;
+
+public:
+	/**
+	 *\brief Constructor that sets the maximum number of snapshots.
+	 *\param capacity maximum number of snapshots in use at once.
+	 */
+	explicit LatticeSnapshotPool(std::size_t capacity = 2);
+
+	/**
+	 *\brief Copies a lattice into a free snapshot, waiting for one if they are all in use.
+	 *\param lattice lattice to copy.
+	 *\return pointer to the snapshot, which must be given back with release().
+	 */
+	ConsensusArray* take(const ConsensusArray &lattice);
+
+	/**
+	 *\brief Returns a snapshot to the pool so it can be reused.
+	 *\param snapshot pointer obtained from take().
+	 */
+	void release(ConsensusArray *snapshot);
+};
+
+#endif /* LatticeSnapshotPool_hpp */
@@ -0,0 +1,128 @@
+#include "LatticeStorage.hpp"
+#include <cstring>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+LatticeStorage::LatticeStorage(long long size) :
+	m_data{size > 0 ? new State[size] : nullptr},
+	m_size{size},
+	m_mapped{false}
+{
+
+}
+
+LatticeStorage::LatticeStorage(const std::string &fileName, long long size) :
+	m_data{nullptr},
+	m_size{size},
+	m_mapped{true}
+{
+	// A mapping cannot be empty.
+	if(size <= 0)
+	{
+		throw std::invalid_argument("A mapped lattice needs at least one cell.");
+	}
+
+	int fileDescriptor = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+	if(fileDescriptor < 0)
+	{
+		throw std::runtime_error("Could not open " + fileName);
+	}
+
+	if(ftruncate(fileDescriptor, static_cast<off_t>(size)) < 0)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Could not resize " + fileName);
+	}
+
+	void *mapping = mmap(nullptr, static_cast<std::size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if(MAP_FAILED == mapping)
+	{
+		throw std::runtime_error("Could not map " + fileName);
+	}
+
+	m_data = static_cast<State*>(mapping);
+}
+
+LatticeStorage::LatticeStorage(const LatticeStorage &other) : LatticeStorage(other.m_size)
+{
+	std::memcpy(m_data, other.m_data, static_cast<std::size_t>(m_size));
+}
+
+LatticeStorage::LatticeStorage(LatticeStorage &&other) noexcept :
+	m_data{other.m_data},
+	m_size{other.m_size},
+	m_mapped{other.m_mapped}
+{
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_mapped = false;
+}
+
+LatticeStorage& LatticeStorage::operator=(const LatticeStorage &other)
+{
+	if(this == &other)
+	{
+		return *this;
+	}
+
+	// Only reallocate when the sizes differ, so snapshots can be taken into a reused buffer.
+	if(m_size != other.m_size)
+	{
+		LatticeStorage copy(other.m_size);
+		*this = std::move(copy);
+	}
+
+	std::memcpy(m_data, other.m_data, static_cast<std::size_t>(m_size));
+	return *this;
+}
+
+LatticeStorage& LatticeStorage::operator=(LatticeStorage &&other) noexcept
+{
+	if(this != &other)
+	{
+		release();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		m_mapped = other.m_mapped;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_mapped = false;
+	}
+	return *this;
+}
+
+LatticeStorage::~LatticeStorage()
+{
+	release();
+}
+
+void LatticeStorage::release()
+{
+	if(m_mapped)
+	{
+		if(m_data)
+		{
+			munmap(m_data, static_cast<std::size_t>(m_size));
+		}
+	}
+	else
+	{
+		delete[] m_data;
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
+
+void LatticeStorage::adviseAccess(bool sequential)
+{
+	if(m_mapped && m_data)
+	{
+		madvise(m_data, static_cast<std::size_t>(m_size), sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+}
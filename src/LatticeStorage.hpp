@@ -0,0 +1,139 @@
+#ifndef LatticeStorage_hpp
+#define LatticeStorage_hpp
+
+#include <string> // For the backing file name.
+#include <cstddef> // For std::size_t.
+#include <stdexcept> // For reporting failures.
+#include "ConsensusModel.hpp"
+
+/**
+ *\file
+ *\class LatticeStorage
+ *\brief Class that owns the cells of a lattice, either on the heap or in a memory-mapped file.
+ *
+ * Cells are packed one byte each. A file backed lattice is mapped shared so the kernel pages
+ * cells in and out as they are touched, which lets a lattice larger than RAM be simulated as long
+ * as the updates are local enough (see ConsensusArray::Tiled). The file keeps the last state of the
+ * lattice when the program exits and can be mapped again, with the same size and layout, to carry
+ * on from it (--init keep).
+ *
+ * Copies are always held on the heap, assigning one storage to another of the same size copies
+ * the cells in place.
+ */
+class LatticeStorage
+{
+public:
+	/// Type of each cell.
+	using State = ConsensusModel::State;
+
+private:
+	/// Pointer to the first cell.
+	State *m_data;
+
+	/// Number of cells.
+	long long m_size;
+
+	/// True if the cells live in a mapped file rather than on the heap.
+	bool m_mapped;
+
+	/**
+	 *\brief Releases the heap allocation or the mapping.
+	 */
+	void release();
+
+public:
+	/**
+	 *\brief Constructor that allocates the cells on the heap, the cells are not initialised.
+	 *\param size number of cells.
+	 */
+	explicit LatticeStorage(long long size = 0);
+
+	/**
+	 *\brief Constructor that maps the cells from a file, throws std::invalid_argument for no cells and std::runtime_error on failure.
+	 *
+	 * The file is created if it does not exist and resized to hold exactly size cells, cells that
+	 * were already in the file keep their value.
+	 *
+	 *\param fileName path of the backing file.
+	 *\param size number of cells.
+	 */
+	LatticeStorage(const std::string &fileName, long long size);
+
+	/**
+	 *\brief Copy constructor, the copy is always held on the heap.
+	 *\param other storage to copy.
+	 */
+	LatticeStorage(const LatticeStorage &other);
+
+	/**
+	 *\brief Move constructor, takes ownership of the cells.
+	 *\param other storage to move from, it is left empty.
+	 */
+	LatticeStorage(LatticeStorage &&other) noexcept;
+
+	/**
+	 *\brief Copy assignment, reuses the existing cells if the sizes match.
+	 *\param other storage to copy.
+	 *\return reference to this storage.
+	 */
+	LatticeStorage& operator=(const LatticeStorage &other);
+
+	/**
+	 *\brief Move assignment, takes ownership of the cells.
+	 *\param other storage to move from, it is left empty.
+	 *\return reference to this storage.
+	 */
+	LatticeStorage& operator=(LatticeStorage &&other) noexcept;
+
+	/**
+	 *\brief Destructor that frees or unmaps the cells, flushing a mapped file back to disk.
+	 */
+	~LatticeStorage();
+
+	/**
+	 *\brief operator overload for accessing a cell.
+	 *\param index position of the cell.
+	 *\return reference to the cell.
+	 */
+	State& operator[](long long index) { return m_data[index]; }
+
+	/**
+	 *\brief constant version of non-constant counterpart.
+	 *\param index position of the cell.
+	 *\return constant reference to the cell.
+	 */
+	const State& operator[](long long index) const { return m_data[index]; }
+
+	/**
+	 *\brief Getter for the number of cells.
+	 *\return Integer value representing the number of cells.
+	 */
+	long long size() const { return m_size; }
+
+	/**
+	 *\brief Getter for whether the cells live in a mapped file.
+	 *\return Boolean which is true for a file backed storage.
+	 */
+	bool isMapped() const { return m_mapped; }
+
+	/// Pointer to the first cell.
+	State* data() { return m_data; }
+	/// Constant pointer to the first cell.
+	const State* data() const { return m_data; }
+	/// Iterator to the first cell.
+	State* begin() { return m_data; }
+	/// Iterator past the last cell.
+	State* end() { return m_data + m_size; }
+	/// Constant iterator to the first cell.
+	const State* begin() const { return m_data; }
+	/// Constant iterator past the last cell.
+	const State* end() const { return m_data + m_size; }
+
+	/**
+	 *\brief Tells the kernel how the cells will be accessed, only has an effect on mapped storage.
+	 *\param sequential true for front to back scans, false for random access.
+	 */
+	void adviseAccess(bool sequential);
+};
+
+#endif /* LatticeStorage_hpp */
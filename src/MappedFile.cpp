@@ -0,0 +1,58 @@
+#include "MappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &fileName) : m_data{nullptr}, m_size{0}
+{
+	int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if(fileDescriptor < 0)
+	{
+		throw std::runtime_error("Could not open " + fileName);
+	}
+
+	struct stat fileStatus;
+	if(fstat(fileDescriptor, &fileStatus) < 0)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Could not stat " + fileName);
+	}
+
+	m_size = static_cast<std::size_t>(fileStatus.st_size);
+
+	// Mapping an empty file fails, leave it as a null mapping of size zero.
+	if(m_size > 0)
+	{
+		m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if(MAP_FAILED == m_data)
+		{
+			close(fileDescriptor);
+			throw std::runtime_error("Could not map " + fileName);
+		}
+
+		// The files are scanned front to back so let the kernel read ahead aggressively.
+		madvise(m_data, m_size, MADV_SEQUENTIAL);
+	}
+
+	// The mapping stays valid after the descriptor is closed.
+	close(fileDescriptor);
+}
+
+MappedFile::~MappedFile()
+{
+	if(m_data)
+	{
+		munmap(m_data, m_size);
+	}
+}
+
+const char* MappedFile::data() const
+{
+	return static_cast<const char*>(m_data);
+}
+
+std::size_t MappedFile::size() const
+{
+	return m_size;
+}
@@ -0,0 +1,54 @@
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <string> // For the file name.
+#include <cstddef> // For std::size_t.
+#include <stdexcept> // For reporting failures.
+
+/**
+ *\file
+ *\class MappedFile
+ *\brief Class that memory-maps a whole file for reading and unmaps it when it goes out of scope.
+ *
+ * Large input files (edge lists, packed lattices) are read through the page cache this way rather
+ * than being copied through a stream buffer, so they can be scanned at memory bandwidth and never
+ * need to fit in the heap at once.
+ */
+class MappedFile
+{
+private:
+	/// Pointer to the start of the mapping.
+	void *m_data;
+
+	/// Size of the mapping in bytes.
+	std::size_t m_size;
+
+public:
+	/**
+	 *\brief Constructor that maps the file, throws std::runtime_error if it cannot be opened.
+	 *\param fileName path of the file to map.
+	 */
+	explicit MappedFile(const std::string &fileName);
+
+	/**
+	 *\brief Destructor that unmaps the file.
+	 */
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 *\brief Getter for the start of the mapped file.
+	 *\return constant pointer to the first byte of the file.
+	 */
+	const char* data() const;
+
+	/**
+	 *\brief Getter for the size of the mapped file.
+	 *\return size of the file in bytes.
+	 */
+	std::size_t size() const;
+};
+
+#endif /* MappedFile_hpp */
@@ -0,0 +1,203 @@
+#include "MeanFieldConsensus.hpp"
+
+constexpr int MeanFieldConsensus::channelCount;
+
+namespace
+{
+    /// Invading species of each channel, cyclic invasions first then anti-cyclic ones.
+    const ConsensusModel::State channelSource[] = {
+        ConsensusModel::Red, ConsensusModel::Green, ConsensusModel::Blue,
+        ConsensusModel::Green, ConsensusModel::Blue, ConsensusModel::Red};
+
+    /// Invaded species of each channel.
+    const ConsensusModel::State channelTarget[] = {
+        ConsensusModel::Green, ConsensusModel::Blue, ConsensusModel::Red,
+        ConsensusModel::Red, ConsensusModel::Green, ConsensusModel::Blue};
+}
+
+MeanFieldConsensus::MeanFieldConsensus(
+    std::default_random_engine &generator,
+    long long population,
+    double prob1,
+    double prob2,
+    MeanFieldConsensus::Method method,
+    double tau
+    ) : ConsensusModel(prob1, prob2),
+        m_counts{0, 0, 0},
+        m_population{population},
+        m_method{method},
+        m_tau{tau}
+{
+    randomise(generator);
+}
+
+void MeanFieldConsensus::randomise(std::default_random_engine &generator)
+{
+    // Sampling each species in turn from a binomial is the same as giving every individual an
+    // equally likely species, without ever touching the individuals.
+    std::binomial_distribution<long long> redDistribution(m_population, 1.0/3.0);
+    long long red = redDistribution(generator);
+
+    std::binomial_distribution<long long> greenDistribution(m_population - red, 0.5);
+    long long green = greenDistribution(generator);
+
+    setCounts(red, green, m_population - red - green);
+}
+
+long long MeanFieldConsensus::getSize() const
+{
+    return m_population;
+}
+
+long long MeanFieldConsensus::stateCount(ConsensusModel::State state) const
+{
+    return m_counts[state];
+}
+
+void MeanFieldConsensus::setCounts(long long red, long long green, long long blue)
+{
+    m_counts[Red]   = red;
+    m_counts[Green] = green;
+    m_counts[Blue]  = blue;
+    m_population    = red + green + blue;
+}
+
+MeanFieldConsensus::Method MeanFieldConsensus::getMethod() const
+{
+    return m_method;
+}
+
+void MeanFieldConsensus::setMethod(MeanFieldConsensus::Method method, double tau)
+{
+    m_method = method;
+    m_tau    = tau;
+}
+
+double MeanFieldConsensus::channelRates(double rates[channelCount]) const
+{
+    double total = 0;
+
+    // In one sweep there are N attempts, each picks the invader with probability n_s/N and a
+    // distinct target with probability n_t/(N-1).
+    double normalisation = m_population > 1 ? 1.0/(m_population - 1) : 0.0;
+
+    for(int channel = 0; channel < channelCount; ++channel)
+    {
+        State source = channelSource[channel];
+        State target = channelTarget[channel];
+
+        rates[channel] = static_cast<double>(m_counts[source]) * m_counts[target]
+            * getProbability(source, target) * normalisation;
+
+        total += rates[channel];
+    }
+
+    return total;
+}
+
+void MeanFieldConsensus::gillespieSweep(std::default_random_engine &generator)
+{
+    static std::uniform_real_distribution<double> distribution(0.0,1.0);
+
+    double rates[channelCount];
+    double time = 0;
+
+    while(true)
+    {
+        double totalRate = channelRates(rates);
+
+        // No channel can fire once the population has reached an absorbing state.
+        if(totalRate <= 0)
+        {
+            return;
+        }
+
+        // Waiting times are memoryless so an event that would land past the end of the sweep
+        // can simply be discarded.
+        std::exponential_distribution<double> waitingTime(totalRate);
+        time += waitingTime(generator);
+        if(time >= 1.0)
+        {
+            return;
+        }
+
+        // Select the channel with probability proportional to its rate.
+        double threshold = distribution(generator) * totalRate;
+        int channel = 0;
+        while(channel < channelCount - 1 && threshold >= rates[channel])
+        {
+            threshold -= rates[channel];
+            ++channel;
+        }
+
+        ++m_counts[channelSource[channel]];
+        --m_counts[channelTarget[channel]];
+    }
+}
+
+void MeanFieldConsensus::tauLeapingSweep(std::default_random_engine &generator)
+{
+    double rates[channelCount];
+    double remaining = 1.0;
+
+    while(remaining > 0)
+    {
+        double totalRate = channelRates(rates);
+        if(totalRate <= 0)
+        {
+            return;
+        }
+
+        double leap = std::min(m_tau, remaining);
+
+        // Fire every channel a Poisson number of times, halving the leap whenever a species
+        // would be driven negative.
+        while(true)
+        {
+            long long counts[MAXSTATE] = {m_counts[Red], m_counts[Green], m_counts[Blue]};
+
+            for(int channel = 0; channel < channelCount; ++channel)
+            {
+                if(rates[channel] > 0)
+                {
+                    std::poisson_distribution<long long> events(rates[channel] * leap);
+                    long long firings = events(generator);
+                    counts[channelSource[channel]] += firings;
+                    counts[channelTarget[channel]] -= firings;
+                }
+            }
+
+            if(counts[Red] >= 0 && counts[Green] >= 0 && counts[Blue] >= 0)
+            {
+                setCounts(counts[Red], counts[Green], counts[Blue]);
+                break;
+            }
+
+            leap /= 2;
+        }
+
+        remaining -= leap;
+    }
+}
+
+void MeanFieldConsensus::sweep(std::default_random_engine &generator)
+{
+    switch (m_method) {
+      case Gillespie:
+        gillespieSweep(generator);
+        break;
+
+      case TauLeaping:
+        tauLeapingSweep(generator);
+        break;
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, const MeanFieldConsensus &population)
+{
+    out << population.stateCount(ConsensusModel::Red) << ' '
+        << population.stateCount(ConsensusModel::Green) << ' '
+        << population.stateCount(ConsensusModel::Blue) << '\n';
+
+    return out;
+}
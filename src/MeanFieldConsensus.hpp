@@ -0,0 +1,143 @@
+#ifndef MeanFieldConsensus_hpp
+#define MeanFieldConsensus_hpp
+
+#include <random> // For generating random numbers.
+#include <iostream> // For outputting the counts.
+#include <algorithm> // For std::min.
+#include "ConsensusModel.hpp"
+
+/**
+ * \file
+ * \class MeanFieldConsensus
+ * \brief Class to model a well-mixed (mean-field) population in the Consensus model.
+ *
+ * Only the number of individuals of each species is stored. An update picks an ordered pair of
+ * distinct individuals uniformly at random and, with the usual p_1/p_2 probabilities, the first
+ * invades the second, which is exactly the lattice update with every individual as a neighbour.
+ * This lets the six invasion channels be sampled directly from their rates, either exactly
+ * (Gillespie) at O(1) cost per event or approximately with tau-leaping for very large populations.
+ */
+class MeanFieldConsensus : public ConsensusModel
+{
+public:
+    /**
+     * \enum Method
+     * \brief Enumeration type to hold the stochastic simulation algorithm used for a sweep.
+     */
+    enum Method
+    {
+        Gillespie,
+        TauLeaping,
+    };
+
+private:
+    /// Number of invasion channels, one per ordered pair of distinct species.
+    static constexpr int channelCount = 6;
+
+    /// Member variable that holds the number of individuals of each species.
+    long long m_counts[MAXSTATE];
+
+    /// Member variable that holds the total number of individuals.
+    long long m_population;
+
+    /// Member variable that holds the algorithm used to advance the population.
+    Method m_method;
+
+    /// Member variable that holds the leap size in sweeps when tau-leaping.
+    double m_tau;
+
+    /**
+     *\brief Calculates the rate (events per sweep) of each invasion channel.
+     *\param rates array to be filled with the rate of each channel.
+     *\return Floating point value representing the total rate.
+     */
+    double channelRates(double rates[channelCount]) const;
+
+    /**
+     *\brief Performs exact Gillespie steps until one sweep of time has elapsed.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void gillespieSweep(std::default_random_engine &generator);
+
+    /**
+     *\brief Performs tau-leaps until one sweep of time has elapsed.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void tauLeapingSweep(std::default_random_engine &generator);
+
+public:
+    /**
+     *\brief Constructor that splits the population between species with equal probability.
+     *\param generator std::default_random_engine reference for random number generation.
+     *\param population total number of individuals.
+     *\param prob1 probability of a cyclic invasion.
+     *\param prob2 probability of an anti-cyclic invasion.
+     *\param method algorithm used to advance the population.
+     *\param tau leap size in sweeps, only used when tau-leaping.
+     */
+    MeanFieldConsensus(
+        std::default_random_engine &generator,
+        long long population = 2500,
+        double prob1 = 1.0,
+        double prob2 = 1.0,
+        MeanFieldConsensus::Method method = MeanFieldConsensus::Gillespie,
+        double tau = 0.01
+        );
+
+    /**
+     *\brief Randomises the species of every individual with equal probability.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void randomise(std::default_random_engine &generator);
+
+    /**
+     *\brief Getter for the total number of individuals.
+     *\return Integer value representing the population size.
+     */
+    long long getSize() const override;
+
+    /**
+     *\brief Getter for the number of individuals in a given state.
+     *\param state value representing the state of interest.
+     *\return Integer value representing the number of individuals in the state of interest.
+     */
+    long long stateCount(ConsensusModel::State state) const override;
+
+    /**
+     *\brief Setter for the number of individuals in each state, the population is the total.
+     *\param red number of red individuals.
+     *\param green number of green individuals.
+     *\param blue number of blue individuals.
+     */
+    void setCounts(long long red, long long green, long long blue);
+
+    /**
+     *\brief Getter for the algorithm used to advance the population.
+     *\return Method value.
+     */
+    MeanFieldConsensus::Method getMethod() const;
+
+    /**
+     *\brief Setter for the algorithm used to advance the population.
+     *\param method algorithm to use.
+     *\param tau leap size in sweeps, only used when tau-leaping.
+     */
+    void setMethod(MeanFieldConsensus::Method method, double tau = 0.01);
+
+    /**
+     *\brief Advances the population by one sweep, i.e. one unit of time in which every individual
+     * attempts on average one invasion.
+     *\param generator std::default_random_engine reference for random number generation.
+     */
+    void sweep(std::default_random_engine &generator) override;
+
+    /**
+     *\brief streams the species counts to an output stream.
+     *\param out std::ostream reference that is being streamed to.
+     *\param population MeanFieldConsensus reference to be printed.
+     *\return std::ostream reference to output can be chained.
+     */
+    friend std::ostream& operator<<(std::ostream& out, const MeanFieldConsensus &population);
+};
+
+#endif /* MeanFieldConsensus_hpp */
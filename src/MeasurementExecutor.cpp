@@ -0,0 +1,131 @@
+#include "MeasurementExecutor.hpp"
+#include "PhaseProfiler.hpp"
+#include <algorithm>
+
+MeasurementExecutor::MeasurementExecutor(int threadCount, std::size_t poolSize) :
+	m_readsCells{false},
+	m_pool(poolSize > 0 ? poolSize : static_cast<std::size_t>(std::max(1, threadCount)) + 1),
+	m_submitted{0},
+	m_written{0},
+	m_finished{false},
+	m_threadCount{std::max(1, threadCount)}
+{
+
+}
+
+MeasurementExecutor::~MeasurementExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finished = true;
+	}
+	m_queued.notify_all();
+
+	for(auto &worker : m_workers)
+	{
+		worker.join();
+	}
+
+	for(auto sink : m_sinks)
+	{
+		sink->flush();
+	}
+}
+
+void MeasurementExecutor::add(std::unique_ptr<IObservable> observable, std::ostream &out)
+{
+	m_readsCells = m_readsCells || observable->readsCells();
+	m_observables.push_back(std::move(observable));
+	m_sinks.push_back(&out);
+}
+
+void MeasurementExecutor::submit(const ConsensusArray &lattice, int sweep)
+{
+	// Counts are read straight from the lattice, and a mapped lattice is never copied to the heap.
+	if(!m_readsCells || lattice.getStorage().isMapped())
+	{
+		Result result = measure(lattice, sweep);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		record(m_submitted++, std::move(result));
+		return;
+	}
+
+	if(m_workers.empty())
+	{
+		for(int thread = 0; thread < m_threadCount; ++thread)
+		{
+			m_workers.emplace_back(&MeasurementExecutor::run, this);
+		}
+	}
+
+	// Taking the snapshot blocks if the workers are too far behind.
+	ConsensusArray *snapshot = m_pool.take(lattice);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(Job{m_submitted++, sweep, snapshot});
+	}
+	m_queued.notify_one();
+}
+
+void MeasurementExecutor::run()
+{
+	while(true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queued.wait(lock, [this]() { return m_finished || !m_queue.empty(); });
+
+			// Only stop once every submitted snapshot has been measured.
+			if(m_queue.empty())
+			{
+				return;
+			}
+
+			job = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		// Measured while the sweeps continue, so counted in its own phase when profiling.
+		PhaseProfiler::ThreadScope scope(PhaseProfiler::Measurement);
+		Result result = measure(*job.snapshot, job.sweep);
+		m_pool.release(job.snapshot);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		record(job.sequence, std::move(result));
+	}
+}
+
+MeasurementExecutor::Result MeasurementExecutor::measure(const ConsensusArray &lattice, int sweep) const
+{
+	Result result{sweep, {}};
+	result.values.reserve(m_observables.size());
+	for(const auto &observable : m_observables)
+	{
+		result.values.push_back(observable->measure(lattice));
+	}
+	return result;
+}
+
+void MeasurementExecutor::record(long long sequence, Result result)
+{
+	// Write this result and any later ones it was holding up, keeping the output in sweep order.
+	m_results.emplace(sequence, std::move(result));
+	for(auto next = m_results.find(m_written); next != m_results.end(); next = m_results.find(m_written))
+	{
+		for(std::size_t observable = 0; observable < m_sinks.size(); ++observable)
+		{
+			std::ostream &out = *m_sinks[observable];
+			out << next->second.sweep;
+			for(double value : next->second.values[observable])
+			{
+				out << ' ' << value;
+			}
+			out << '\n';
+		}
+
+		m_results.erase(next);
+		++m_written;
+	}
+}
@@ -0,0 +1,171 @@
+#ifndef MeasurementExecutor_hpp
+#define MeasurementExecutor_hpp
+
+#include <vector> // For observables, results and workers.
+#include <map> // For results waiting to be written in order.
+#include <deque> // For the queue of snapshots.
+#include <memory> // For owning the observables.
+#include <thread> // For measuring off the sweep thread.
+#include <mutex> // For guarding the queues.
+#include <condition_variable> // For waking the workers.
+#include <iostream> // For the output sinks.
+#include "ConsensusArray.hpp"
+#include "LatticeSnapshotPool.hpp"
+
+/**
+ *\file
+ *\class MeasurementExecutor
+ *\brief Class that measures observables of a lattice on worker threads while the sweeps continue.
+ *
+ * When an observable reads the cells, submit() copies the lattice into a pooled snapshot and queues
+ * it. Each worker takes a snapshot, runs every registered observable on it and then releases it, so
+ * with several workers several sweeps are measured at once. Observables that only read the counts
+ * the lattice tracks are measured at once on the calling thread with no copy, and so is everything
+ * when the lattice is held in a mapped file, which may not fit in memory even once. Results are
+ * written to each observable's output stream strictly in the order of submission, one line of
+ * "sweep value value ..." per measurement.
+ *
+ * A snapshot is a plain ConsensusArray, so the site classes and zealots of a
+ * DisorderedConsensusArray are not copied: observables only ever see the cells and counts.
+ */
+class MeasurementExecutor
+{
+public:
+	/**
+	 *\class IObservable
+	 *\brief Interface for a quantity measured from a lattice.
+	 *
+	 * measure() may be called on several snapshots at once from different threads, so it must
+	 * not modify the observable.
+	 */
+	class IObservable
+	{
+	public:
+		virtual ~IObservable() {}
+
+		/**
+		 *\brief Measures the observable.
+		 *\param lattice snapshot of the lattice.
+		 *\return the values written on one output line.
+		 */
+		virtual std::vector<double> measure(const ConsensusArray &lattice) const = 0;
+
+		/**
+		 *\brief Whether measure() reads the cells, rather than only the counts the lattice tracks.
+		 *\return true if the lattice has to be copied to be measured while the sweeps continue.
+		 */
+		virtual bool readsCells() const { return true; }
+	};
+
+private:
+	/// A queued snapshot.
+	struct Job
+	{
+		/// Position in submission order.
+		long long sequence;
+		/// Sweep the snapshot was taken at.
+		int sweep;
+		/// Snapshot of the lattice, owned by the pool.
+		ConsensusArray *snapshot;
+	};
+
+	/// Measured values of every observable for one snapshot.
+	struct Result
+	{
+		/// Sweep the snapshot was taken at.
+		int sweep;
+		/// Values of each observable, in registration order.
+		std::vector<std::vector<double>> values;
+	};
+
+	/// Member variable that holds the registered observables.
+	std::vector<std::unique_ptr<IObservable>> m_observables;
+
+	/// Member variable that holds the output stream of each observable.
+	std::vector<std::ostream*> m_sinks;
+
+	/// Member variable that is true if any registered observable reads the cells.
+	bool m_readsCells;
+
+	/// Member variable that holds the reusable snapshots.
+	LatticeSnapshotPool m_pool;
+
+	/// Member variable that holds the snapshots waiting to be measured.
+	std::deque<Job> m_queue;
+
+	/// Member variable that holds finished results until every earlier one has been written.
+	std::map<long long, Result> m_results;
+
+	/// Member variable that holds the sequence number of the next submitted snapshot.
+	long long m_submitted;
+
+	/// Member variable that holds the sequence number of the next result to write.
+	long long m_written;
+
+	/// Member variable that is true once no more snapshots will be submitted.
+	bool m_finished;
+
+	/// Member variable that guards the queue and the results.
+	std::mutex m_mutex;
+
+	/// Member variable that is notified when a snapshot is queued or the executor is finished.
+	std::condition_variable m_queued;
+
+	/// Member variable that holds the number of worker threads.
+	int m_threadCount;
+
+	/// Member variable that holds the worker threads, started by the first submit().
+	std::vector<std::thread> m_workers;
+
+	/**
+	 *\brief Loop run by each worker thread.
+	 */
+	void run();
+
+	/**
+	 *\brief Measures every observable of a lattice.
+	 *\param lattice lattice or snapshot to measure.
+	 *\param sweep sweep the lattice is at.
+	 *\return the values of each observable.
+	 */
+	Result measure(const ConsensusArray &lattice, int sweep) const;
+
+	/**
+	 *\brief Stores a result and writes it and any later ones it was holding up, must be called with the mutex held.
+	 *\param sequence position of the result in submission order.
+	 *\param result the result.
+	 */
+	void record(long long sequence, Result result);
+
+public:
+	/**
+	 *\brief Constructor.
+	 *\param threadCount number of worker threads.
+	 *\param poolSize maximum number of snapshots in flight before submit() blocks, 0 uses one more than the threads.
+	 */
+	explicit MeasurementExecutor(int threadCount = 1, std::size_t poolSize = 0);
+
+	/**
+	 *\brief Destructor that measures every queued snapshot, writes the results and stops the workers.
+	 */
+	~MeasurementExecutor();
+
+	MeasurementExecutor(const MeasurementExecutor&) = delete;
+	MeasurementExecutor& operator=(const MeasurementExecutor&) = delete;
+
+	/**
+	 *\brief Registers an observable, must be called before the first submit().
+	 *\param observable observable to measure at every submitted sweep.
+	 *\param out stream its results are written to, which must outlive the executor.
+	 */
+	void add(std::unique_ptr<IObservable> observable, std::ostream &out);
+
+	/**
+	 *\brief Measures the lattice as it is now, or queues a snapshot of it if an observable reads the cells.
+	 *\param lattice lattice to measure.
+	 *\param sweep sweep number written at the start of each result line.
+	 */
+	void submit(const ConsensusArray &lattice, int sweep);
+};
+
+#endif /* MeasurementExecutor_hpp */
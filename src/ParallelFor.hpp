@@ -0,0 +1,71 @@
+#ifndef ParallelFor_hpp
+#define ParallelFor_hpp
+
+#include <thread> // For running chunks concurrently.
+#include <vector> // For holding the worker threads.
+#include <algorithm> // For std::min and std::max.
+#include "ThreadAffinity.hpp"
+#include "PhaseProfiler.hpp"
+
+/**
+ *\file
+ *\brief Splits the range [0, count) into one contiguous chunk per thread and runs function on each.
+ *
+ * function is called as function(thread, begin, end) with thread in [0, threads). Fewer threads are
+ * used when there would be less than grain items each, so small ranges run on the calling thread
+ * without paying for thread creation. The calling thread does chunk 0. When a ThreadAffinity
+ * policy is set, chunk i runs on a thread pinned as worker w + i, where w is the worker the calling
+ * thread is pinned as, so the memory a chunk touches first is placed on the same NUMA node every
+ * time and a parallelFor started inside a worker stays on that worker's cpus. A calling thread that
+ * is not pinned counts as worker 0 and hands chunk 0 to a pinned thread, unless it is the only
+ * chunk. When profiling, the workers are counted in the PhaseProfiler phase of the calling thread.
+ *
+ *\param threadCount maximum number of threads to use.
+ *\param count number of items.
+ *\param grain minimum number of items worth giving a thread.
+ *\param function callable run on each chunk.
+ */
+template<typename Function>
+void parallelFor(int threadCount, long long count, long long grain, Function function)
+{
+    long long maxThreads = std::max(1LL, count / std::max(1LL, grain));
+    int threads = static_cast<int>(std::max(1LL, std::min<long long>(threadCount, maxThreads)));
+
+    long long chunk = count / threads;
+    long long remainder = count % threads;
+
+    auto begin = [chunk, remainder](int thread) {
+        return thread * chunk + std::min<long long>(thread, remainder);
+    };
+
+    bool pinning = ThreadAffinity::isPinning();
+    int firstWorker = std::max(0, ThreadAffinity::worker());
+    bool callerRunsFirst = !pinning || ThreadAffinity::worker() >= 0 || 1 == threads;
+    PhaseProfiler::Phase phase = PhaseProfiler::threadPhase();
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for(int thread = callerRunsFirst ? 1 : 0; thread < threads; ++thread)
+    {
+        workers.emplace_back([function, thread, begin, pinning, firstWorker, phase]() {
+            PhaseProfiler::ThreadScope scope(phase);
+            if(pinning)
+            {
+                ThreadAffinity::pinWorker(firstWorker + thread);
+            }
+            function(thread, begin(thread), begin(thread + 1));
+        });
+    }
+
+    if(callerRunsFirst)
+    {
+        function(0, begin(0), begin(1));
+    }
+
+    for(auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+#endif /* ParallelFor_hpp */
@@ -0,0 +1,268 @@
+#include "PhaseProfiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+	/// Names of the phases in the report.
+	const char *phaseNames[PhaseProfiler::PHASECOUNT] = {"Setup", "Sweep", "Measurement", "Output"};
+
+	/// Names of the counters in the report.
+	const char *counterNames[PhaseProfiler::COUNTERCOUNT] = {"cycles", "instructions", "LLC-misses", "branch-misses"};
+
+	/// Generic hardware events of the counters.
+	const std::uint64_t counterEvents[PhaseProfiler::COUNTERCOUNT] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	/// The profiler that exists, if any.
+	std::atomic<PhaseProfiler*> activeProfiler(nullptr);
+
+	/// Phase the calling thread's work is counted in.
+	thread_local PhaseProfiler::Phase currentPhase = PhaseProfiler::Setup;
+
+	/**
+	 * Counters of one thread, opened the first time the thread is profiled and closed when it exits.
+	 */
+	class ThreadCounters
+	{
+	private:
+		/// File descriptor of each counter, -1 if it could not be opened.
+		std::array<int, PhaseProfiler::COUNTERCOUNT> m_descriptors;
+
+		/// Error of each counter that could not be opened.
+		std::array<int, PhaseProfiler::COUNTERCOUNT> m_errors;
+
+	public:
+		ThreadCounters()
+		{
+			for(int counter = 0; counter < PhaseProfiler::COUNTERCOUNT; ++counter)
+			{
+				// A user space counter of the calling thread only, glibc has no wrapper for the call.
+				perf_event_attr attributes;
+				std::memset(&attributes, 0, sizeof(attributes));
+				attributes.size = sizeof(attributes);
+				attributes.type = PERF_TYPE_HARDWARE;
+				attributes.config = counterEvents[counter];
+				attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				attributes.exclude_kernel = 1;
+				attributes.exclude_hv = 1;
+				m_descriptors[counter] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+				m_errors[counter] = (m_descriptors[counter] < 0) ? errno : 0;
+			}
+		}
+
+		~ThreadCounters()
+		{
+			for(int descriptor : m_descriptors)
+			{
+				if(descriptor >= 0)
+				{
+					close(descriptor);
+				}
+			}
+		}
+
+		ThreadCounters(const ThreadCounters&) = delete;
+		ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+		/// Error opening a counter, 0 if it is open.
+		int error(int counter) const
+		{
+			return m_errors[counter];
+		}
+
+		/// Reads every open counter, scaled for multiplexing, zero for the others.
+		PhaseProfiler::Counts read() const
+		{
+			PhaseProfiler::Counts values{};
+			for(int counter = 0; counter < PhaseProfiler::COUNTERCOUNT; ++counter)
+			{
+				// The value, then the time the counter was enabled and the time it was actually counting.
+				std::uint64_t buffer[3];
+				if(m_descriptors[counter] < 0 || sizeof(buffer) != ::read(m_descriptors[counter], buffer, sizeof(buffer)))
+				{
+					continue;
+				}
+				values[counter] = (buffer[2] > 0 && buffer[2] < buffer[1]) ? static_cast<double>(buffer[0]) * buffer[1] / buffer[2] : static_cast<double>(buffer[0]);
+			}
+			return values;
+		}
+	};
+
+	/// Counters of the calling thread.
+	ThreadCounters& threadCounters()
+	{
+		thread_local ThreadCounters counters;
+		return counters;
+	}
+}
+
+PhaseProfiler::ThreadScope::ThreadScope(Phase phase) :
+	m_phase{phase},
+	m_previousPhase{currentPhase},
+	m_counting{isActive()},
+	m_start()
+{
+	currentPhase = phase;
+	if(m_counting)
+	{
+		m_start = threadCounters().read();
+	}
+}
+
+PhaseProfiler::ThreadScope::~ThreadScope()
+{
+	currentPhase = m_previousPhase;
+	PhaseProfiler *profiler = activeProfiler.load();
+	if(m_counting && profiler)
+	{
+		profiler->add(m_phase, m_start, threadCounters().read());
+	}
+}
+
+PhaseProfiler::PhaseProfiler() :
+	m_phase{Setup},
+	m_phaseStart(),
+	m_counts(),
+	m_seconds()
+{
+	const ThreadCounters &counters = threadCounters();
+	for(int counter = 0; counter < COUNTERCOUNT; ++counter)
+	{
+		m_available[counter] = (0 == counters.error(counter));
+		if(!m_available[counter] && m_unavailableReason.empty())
+		{
+			m_unavailableReason = std::string(counterNames[counter]) + ": " + std::strerror(counters.error(counter));
+		}
+	}
+
+	currentPhase = Setup;
+	activeProfiler = this;
+	m_phaseStart = counters.read();
+	m_timer.reset();
+}
+
+PhaseProfiler::~PhaseProfiler()
+{
+	activeProfiler = nullptr;
+}
+
+void PhaseProfiler::add(Phase phase, const Counts &start, const Counts &end)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(int counter = 0; counter < COUNTERCOUNT; ++counter)
+	{
+		m_counts[phase][counter] += end[counter] - start[counter];
+	}
+}
+
+void PhaseProfiler::enter(Phase phase)
+{
+	if(phase == m_phase)
+	{
+		return;
+	}
+
+	Counts now = threadCounters().read();
+	m_seconds[m_phase] += m_timer.elapsed();
+	add(m_phase, m_phaseStart, now);
+
+	m_phase = phase;
+	m_phaseStart = now;
+	currentPhase = phase;
+	m_timer.reset();
+}
+
+bool PhaseProfiler::isAvailable(Counter counter) const
+{
+	return m_available[counter];
+}
+
+double PhaseProfiler::count(Phase phase, Counter counter) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_counts[phase][counter];
+}
+
+double PhaseProfiler::seconds(Phase phase) const
+{
+	return m_seconds[phase];
+}
+
+bool PhaseProfiler::isActive()
+{
+	return nullptr != activeProfiler.load(std::memory_order_relaxed);
+}
+
+PhaseProfiler::Phase PhaseProfiler::threadPhase()
+{
+	return currentPhase;
+}
+
+void PhaseProfiler::writeReport(std::ostream &out, double siteUpdates) const
+{
+	int outputColumnWidth = 16;
+	siteUpdates = std::max(1.0, siteUpdates);
+
+	out << "Profile per site update (" << siteUpdates << " updates)..." << '\n';
+	out << std::setw(outputColumnWidth) << std::setfill(' ') << std::left << "Phase" << std::right
+	    << std::setw(outputColumnWidth) << "seconds" << std::setw(outputColumnWidth) << "ns";
+	for(const char *name : counterNames)
+	{
+		out << std::setw(outputColumnWidth) << name;
+	}
+	out << std::setw(outputColumnWidth) << "IPC" << '\n';
+
+	for(int phase = 0; phase < PHASECOUNT; ++phase)
+	{
+		Counts counts;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			counts = m_counts[phase];
+		}
+
+		out << std::setw(outputColumnWidth) << std::left << phaseNames[phase] << std::right
+		    << std::setw(outputColumnWidth) << m_seconds[phase]
+		    << std::setw(outputColumnWidth) << 1e9 * m_seconds[phase] / siteUpdates;
+		for(int counter = 0; counter < COUNTERCOUNT; ++counter)
+		{
+			out << std::setw(outputColumnWidth);
+			if(isAvailable(static_cast<Counter>(counter)))
+			{
+				out << counts[counter] / siteUpdates;
+			}
+			else
+			{
+				out << "n/a";
+			}
+		}
+
+		out << std::setw(outputColumnWidth);
+		if(isAvailable(Cycles) && isAvailable(Instructions) && counts[Cycles] > 0)
+		{
+			out << counts[Instructions] / counts[Cycles];
+		}
+		else
+		{
+			out << "n/a";
+		}
+		out << '\n';
+	}
+
+	out << "Counts include worker threads, seconds are those of the main thread." << '\n';
+	if(!m_unavailableReason.empty())
+	{
+		out << "Hardware counters unavailable (" << m_unavailableReason << "), see /proc/sys/kernel/perf_event_paranoid." << '\n';
+	}
+}
@@ -0,0 +1,194 @@
+#ifndef PhaseProfiler_hpp
+#define PhaseProfiler_hpp
+
+#include <array> // For the counts of each phase.
+#include <string> // For the reason counters are unavailable.
+#include <mutex> // For adding the counts of worker threads.
+#include <iostream> // For the report.
+#include "Timer.hpp"
+
+/**
+ *\file
+ *\class PhaseProfiler
+ *\brief Class that reads hardware performance counters around the phases of a simulation.
+ *
+ * Wall time alone cannot say whether a slow sweep is waiting on memory or mispredicting branches,
+ * so the profiler reads Linux perf_event_open counters for cycles, instructions, last level cache
+ * misses and branch misses, counting user space. Every thread counts only itself, with counters it
+ * opens the first time it is profiled.
+ *
+ * The thread that creates the profiler is always in exactly one phase: enter() reads its counters
+ * and adds what they counted since the phase began to the phase being left. Entering the phase it
+ * is already in does nothing, so enter() may be called around work that may not happen without
+ * reading the counters every time. A worker thread wraps its work in a ThreadScope, which adds the
+ * worker's own counts to the scope's phase when it ends, so work done concurrently with the sweeps,
+ * such as measuring snapshots or rendering frames, is counted in its own phase. parallelFor workers
+ * are counted in the phase of the thread that started them. Wall time is that of the profiler's
+ * thread in each phase.
+ *
+ * A counter that cannot be opened, because the kernel forbids it (see
+ * /proc/sys/kernel/perf_event_paranoid), the processor or virtual machine lacks it, or the system
+ * call is blocked, is reported as unavailable and the others are still read; wall time is always
+ * reported. Counters the kernel multiplexes are scaled by the fraction of time they were running.
+ * Only one profiler may exist at a time.
+ */
+class PhaseProfiler
+{
+public:
+	/// Phases of the simulation.
+	enum Phase
+	{
+		Setup,
+		Sweep,
+		Measurement,
+		Output,
+		PHASECOUNT
+	};
+
+	/// Hardware counters read.
+	enum Counter
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		COUNTERCOUNT
+	};
+
+	/// Counter values.
+	typedef std::array<double, COUNTERCOUNT> Counts;
+
+	/**
+	 *\class ThreadScope
+	 *\brief Counts the work a thread does while the scope exists in a phase of the active profiler.
+	 *
+	 * Does nothing when no profiler exists. Scopes may nest, the inner one's phase applies to
+	 * parallelFor workers started inside it.
+	 */
+	class ThreadScope
+	{
+	private:
+		/// Member variable that holds the phase the work is counted in.
+		Phase m_phase;
+
+		/// Member variable that holds the phase of the thread before the scope.
+		Phase m_previousPhase;
+
+		/// Member variable that is true if a profiler was active when the scope began.
+		bool m_counting;
+
+		/// Member variable that holds the thread's counters when the scope began.
+		Counts m_start;
+
+	public:
+		/**
+		 *\brief Constructor that starts counting.
+		 *\param phase the phase the work is counted in.
+		 */
+		explicit ThreadScope(Phase phase);
+
+		/**
+		 *\brief Destructor that adds the thread's counts since the constructor to the phase.
+		 */
+		~ThreadScope();
+
+		ThreadScope(const ThreadScope&) = delete;
+		ThreadScope& operator=(const ThreadScope&) = delete;
+	};
+
+private:
+	/// Member variable that holds whether each counter could be opened by the profiler's thread.
+	std::array<bool, COUNTERCOUNT> m_available;
+
+	/// Member variable that holds why the first unavailable counter could not be opened.
+	std::string m_unavailableReason;
+
+	/// Member variable that holds the phase the profiler's thread is in.
+	Phase m_phase;
+
+	/// Member variable that holds the profiler's thread's counters when the current phase was entered.
+	Counts m_phaseStart;
+
+	/// Member variable that holds the counts of each phase.
+	std::array<Counts, PHASECOUNT> m_counts;
+
+	/// Member variable that holds the wall time of each phase in seconds.
+	std::array<double, PHASECOUNT> m_seconds;
+
+	/// Member variable that guards the counts, which worker threads add to.
+	mutable std::mutex m_mutex;
+
+	/// Member variable that is reset whenever a phase is entered.
+	Timer m_timer;
+
+	/**
+	 *\brief Adds counts to a phase.
+	 *\param phase the phase.
+	 *\param start counter values when the work began.
+	 *\param end counter values when the work ended.
+	 */
+	void add(Phase phase, const Counts &start, const Counts &end);
+
+public:
+	/**
+	 *\brief Constructor that opens and starts the counters of the calling thread, beginning in the Setup phase.
+	 */
+	PhaseProfiler();
+
+	/**
+	 *\brief Destructor, every ThreadScope must have ended.
+	 */
+	~PhaseProfiler();
+
+	PhaseProfiler(const PhaseProfiler&) = delete;
+	PhaseProfiler& operator=(const PhaseProfiler&) = delete;
+
+	/**
+	 *\brief Ends the current phase and starts another, called from the thread that created the profiler.
+	 *\param phase the phase entered, nothing happens if it is the current one.
+	 */
+	void enter(Phase phase);
+
+	/**
+	 *\brief Whether a counter could be opened.
+	 *\param counter the counter.
+	 *\return true if it is being counted.
+	 */
+	bool isAvailable(Counter counter) const;
+
+	/**
+	 *\brief Count of a counter over a phase, up to the last change of phase and the last ThreadScope to end.
+	 *\param phase the phase.
+	 *\param counter the counter.
+	 *\return the count.
+	 */
+	double count(Phase phase, Counter counter) const;
+
+	/**
+	 *\brief Wall time the profiler's thread spent in a phase up to the last change of phase.
+	 *\param phase the phase.
+	 *\return time in seconds.
+	 */
+	double seconds(Phase phase) const;
+
+	/**
+	 *\brief Writes a table of each phase's wall time and counts per site update, n/a for unavailable counters.
+	 *\param out std::ostream reference for the table.
+	 *\param siteUpdates number of site updates the counts are divided by.
+	 */
+	void writeReport(std::ostream &out, double siteUpdates) const;
+
+	/**
+	 *\brief Tells whether a profiler exists, so workers only open counters when profiling.
+	 *\return true while a profiler exists.
+	 */
+	static bool isActive();
+
+	/**
+	 *\brief Phase the calling thread is counted in, for passing on to the workers it starts.
+	 *\return the phase of its innermost ThreadScope, or of the profiler for the profiler's thread.
+	 */
+	static Phase threadPhase();
+};
+
+#endif /* PhaseProfiler_hpp */
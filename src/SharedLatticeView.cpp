@@ -0,0 +1,198 @@
+#include "SharedLatticeView.hpp"
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	/// Identifies a region written by this class, "CONSVIEW" in ASCII.
+	const std::uint64_t viewMagic = 0x57454956534E4F43ULL;
+
+	/// Version of the region layout.
+	const std::uint32_t viewVersion = 1;
+}
+
+SharedLatticeView::SharedLatticeView(const std::string &name, const ConsensusArray &lattice) :
+	m_name{name},
+	m_header{nullptr},
+	m_cells{nullptr},
+	m_size{sizeof(Header) + static_cast<std::size_t>(lattice.getSize())},
+	m_owner{true}
+{
+	// Never take over an existing region: another run may still be publishing to it and its viewers.
+	int fileDescriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fileDescriptor < 0)
+	{
+		if(EEXIST == errno)
+		{
+			throw std::runtime_error("Shared memory name " + name + " is in use, pick another or remove /dev/shm" + name + " if no run is using it");
+		}
+		throw std::runtime_error("Could not create shared memory " + name);
+	}
+
+	if(ftruncate(fileDescriptor, static_cast<off_t>(m_size)) < 0)
+	{
+		close(fileDescriptor);
+		shm_unlink(name.c_str());
+		throw std::runtime_error("Could not resize shared memory " + name);
+	}
+
+	void *mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(MAP_FAILED == mapping)
+	{
+		shm_unlink(name.c_str());
+		throw std::runtime_error("Could not map shared memory " + name);
+	}
+
+	m_header = new (mapping) Header();
+	m_cells  = reinterpret_cast<ConsensusModel::State*>(static_cast<char*>(mapping) + sizeof(Header));
+
+	m_header->version  = viewVersion;
+	m_header->layout   = static_cast<std::uint32_t>(lattice.getLayout());
+	m_header->rows     = lattice.getRows();
+	m_header->cols     = lattice.getCols();
+	m_header->tileSize = lattice.getTileSize();
+	m_header->sweep    = -1;
+	m_header->generation.store(0, std::memory_order_relaxed);
+
+	// Readers check the magic number last, so it is only written once the rest of the header is.
+	std::atomic_thread_fence(std::memory_order_release);
+	m_header->magic = viewMagic;
+}
+
+SharedLatticeView::SharedLatticeView(const std::string &name) :
+	m_name{name},
+	m_header{nullptr},
+	m_cells{nullptr},
+	m_size{0},
+	m_owner{false}
+{
+	int fileDescriptor = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fileDescriptor < 0)
+	{
+		throw std::runtime_error("Could not open shared memory " + name);
+	}
+
+	struct stat status;
+	if(fstat(fileDescriptor, &status) < 0 || static_cast<std::size_t>(status.st_size) < sizeof(Header))
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Shared memory " + name + " is not a lattice view");
+	}
+	m_size = static_cast<std::size_t>(status.st_size);
+
+	void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(MAP_FAILED == mapping)
+	{
+		throw std::runtime_error("Could not map shared memory " + name);
+	}
+
+	m_header = static_cast<Header*>(mapping);
+	m_cells  = reinterpret_cast<ConsensusModel::State*>(static_cast<char*>(mapping) + sizeof(Header));
+
+	if(viewMagic != m_header->magic || viewVersion != m_header->version
+		|| sizeof(Header) + static_cast<std::size_t>(m_header->rows * m_header->cols) != m_size)
+	{
+		munmap(mapping, m_size);
+		throw std::runtime_error("Shared memory " + name + " is not a lattice view");
+	}
+}
+
+SharedLatticeView::~SharedLatticeView()
+{
+	munmap(m_header, m_size);
+
+	if(m_owner)
+	{
+		shm_unlink(m_name.c_str());
+	}
+}
+
+void SharedLatticeView::publish(const ConsensusArray &lattice, long long sweep)
+{
+	const ConsensusModel::State *cells = lattice.getStorage().data();
+	long long size = lattice.getSize();
+
+	// An odd generation tells readers a publish is in progress.
+	std::uint64_t generation = m_header->generation.load(std::memory_order_relaxed);
+	m_header->generation.store(generation + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::memcpy(m_cells, cells, static_cast<std::size_t>(size));
+	m_header->sweep = sweep;
+	for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+	{
+		m_header->counts[state] = lattice.stateCount(static_cast<ConsensusModel::State>(state));
+	}
+
+	m_header->generation.store(generation + 2, std::memory_order_release);
+}
+
+std::uint64_t SharedLatticeView::snapshot(SharedLatticeView::Snapshot &snapshot) const
+{
+	long long rows = m_header->rows;
+	long long cols = m_header->cols;
+	std::vector<ConsensusModel::State> raw(static_cast<std::size_t>(rows * cols));
+	std::uint64_t before;
+
+	// Copy until the generation is even and unchanged across the copy, i.e. no publish overlapped it.
+	while(true)
+	{
+		before = m_header->generation.load(std::memory_order_acquire);
+		if(before & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::memcpy(raw.data(), m_cells, raw.size());
+		snapshot.sweep = m_header->sweep;
+		for(int state = 0; state < ConsensusModel::MAXSTATE; ++state)
+		{
+			snapshot.counts[state] = m_header->counts[state];
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(m_header->generation.load(std::memory_order_relaxed) == before)
+		{
+			break;
+		}
+	}
+
+	snapshot.rows = rows;
+	snapshot.cols = cols;
+
+	// Put the cells back into row major order, indexing tiles the same way ConsensusArray does.
+	if(ConsensusArray::RowMajor == static_cast<ConsensusArray::Layout>(m_header->layout))
+	{
+		snapshot.cells.swap(raw);
+	}
+	else
+	{
+		int tileShift = 0;
+		while((1LL << tileShift) < m_header->tileSize)
+		{
+			++tileShift;
+		}
+		long long tileMask    = m_header->tileSize - 1;
+		long long tilesPerRow = cols >> tileShift;
+
+		snapshot.cells.resize(raw.size());
+		for(long long row = 0; row < rows; ++row)
+		{
+			for(long long col = 0; col < cols; ++col)
+			{
+				long long tile = (row >> tileShift) * tilesPerRow + (col >> tileShift);
+				snapshot.cells[row * cols + col] = raw[(tile << (2 * tileShift)) | ((row & tileMask) << tileShift) | (col & tileMask)];
+			}
+		}
+	}
+
+	return before;
+}
@@ -0,0 +1,110 @@
+#ifndef SharedLatticeView_hpp
+#define SharedLatticeView_hpp
+
+#include <string> // For the region name.
+#include <vector> // For snapshots.
+#include <atomic> // For the generation counter.
+#include <cstdint> // For the fixed width header.
+#include <stdexcept> // For reporting failures.
+#include "ConsensusArray.hpp"
+
+/**
+ *\file
+ *\class SharedLatticeView
+ *\brief Class that publishes the running lattice in a POSIX shared memory region for other processes to view.
+ *
+ * The region holds a small header (shape, layout, sweep, species counts) followed by the cells,
+ * one byte each in the lattice's storage order. Writes are guarded by a sequence lock: the
+ * generation counter is odd while the simulation is copying a new state in and even otherwise, so
+ * a reader that sees the same even generation before and after its copy knows the copy is a whole,
+ * consistent frame. The simulation never waits for readers and readers never touch a file.
+ */
+class SharedLatticeView
+{
+public:
+	/**
+	 *\struct Snapshot
+	 *\brief A consistent copy of the published lattice with the cells in row major order.
+	 */
+	struct Snapshot
+	{
+		/// Number of rows.
+		long long rows;
+		/// Number of columns.
+		long long cols;
+		/// Sweep the lattice was published at.
+		long long sweep;
+		/// Number of cells in each state.
+		long long counts[ConsensusModel::MAXSTATE];
+		/// Cells in row major order.
+		std::vector<ConsensusModel::State> cells;
+	};
+
+private:
+	/// Layout of the start of the shared region.
+	struct Header
+	{
+		std::uint64_t magic;
+		std::uint32_t version;
+		std::uint32_t layout;
+		std::int64_t rows;
+		std::int64_t cols;
+		std::int64_t tileSize;
+		std::atomic<std::uint64_t> generation;
+		std::int64_t sweep;
+		std::int64_t counts[ConsensusModel::MAXSTATE];
+	};
+
+	/// Member variable that holds the name of the region.
+	std::string m_name;
+
+	/// Member variable that points at the header of the mapped region.
+	Header *m_header;
+
+	/// Member variable that points at the cells of the mapped region.
+	ConsensusModel::State *m_cells;
+
+	/// Member variable that holds the size of the mapping in bytes.
+	std::size_t m_size;
+
+	/// Member variable that is true for the process that created, and will remove, the region.
+	bool m_owner;
+
+public:
+	/**
+	 *\brief Constructor that creates a region shaped for a lattice, throws std::runtime_error on failure or if the name is in use.
+	 *\param name name of the region, e.g. "/consensus".
+	 *\param lattice lattice whose shape and layout the region holds.
+	 */
+	SharedLatticeView(const std::string &name, const ConsensusArray &lattice);
+
+	/**
+	 *\brief Constructor that attaches read only to an existing region, throws std::runtime_error on failure.
+	 *\param name name of the region.
+	 */
+	explicit SharedLatticeView(const std::string &name);
+
+	/**
+	 *\brief Destructor that unmaps the region, and removes it if this process created it.
+	 */
+	~SharedLatticeView();
+
+	SharedLatticeView(const SharedLatticeView&) = delete;
+	SharedLatticeView& operator=(const SharedLatticeView&) = delete;
+
+	/**
+	 *\brief Copies the lattice and its species counts into the region.
+	 *\param lattice lattice to publish, must have the shape the region was created for.
+	 *\param sweep current sweep.
+	 */
+	void publish(const ConsensusArray &lattice, long long sweep);
+
+	/**
+	 *\brief Takes a consistent copy of the published lattice, retrying while a publish is in progress.
+	 *\param snapshot filled with the copy, its buffer is reused between calls.
+	 *\return the generation of the copy, which only changes when a new lattice has been published.
+	 */
+	std::uint64_t snapshot(SharedLatticeView::Snapshot &snapshot) const;
+};
+
+#endif /* SharedLatticeView_hpp */
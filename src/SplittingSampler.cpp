@@ -0,0 +1,233 @@
+#include "SplittingSampler.hpp"
+#include "LatticeInitialiser.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	/// A lattice entering a level: the state it was in when it crossed the level and the sweep it crossed at.
+	struct Entrance
+	{
+		ConsensusArray *lattice;
+		int sweep;
+	};
+}
+
+SplittingSampler::SplittingSampler(long long rows, long long cols, double p1, double p2, ConsensusArray::Layout layout, int tileSize,
+	std::vector<double> levels, long long trials, int maxSweeps, int threadCount, std::uint64_t seed) :
+	m_rows{rows},
+	m_cols{cols},
+	m_p1{p1},
+	m_p2{p2},
+	m_layout{layout},
+	m_tileSize{tileSize},
+	m_levels(std::move(levels)),
+	m_trials{std::max(1LL, trials)},
+	m_maxSweeps{maxSweeps},
+	m_threadCount{std::max(1, threadCount)},
+	m_seed{seed}
+{
+	if(m_levels.empty() || m_levels.back() < 1)
+	{
+		m_levels.push_back(1);
+	}
+
+	for(std::size_t level = 0; level < m_levels.size(); ++level)
+	{
+		if(m_levels[level] <= 0 || m_levels[level] > 1 || (level > 0 && m_levels[level] <= m_levels[level - 1]))
+		{
+			throw std::invalid_argument("Splitting levels must be increasing majority fractions in (0, 1].");
+		}
+	}
+}
+
+std::vector<double> SplittingSampler::evenLevels(double first, int count)
+{
+	std::vector<double> levels;
+	for(int level = 0; level < count; ++level)
+	{
+		levels.push_back((count > 1) ? first + (1 - first) * level / (count - 1) : 1);
+	}
+	return levels;
+}
+
+double SplittingSampler::majorityFraction(const ConsensusArray &lattice)
+{
+	// The counts are tracked by the lattice, so this costs nothing after every sweep.
+	long long largest = std::max(std::max(lattice.stateCount(ConsensusModel::Red), lattice.stateCount(ConsensusModel::Green)),
+		lattice.stateCount(ConsensusModel::Blue));
+	return static_cast<double>(largest) / lattice.getSize();
+}
+
+std::vector<long long> SplittingSampler::runRepetition(int repetition, LatticeSnapshotPool &pool, std::ostream &progress) const
+{
+	// One working lattice per thread, assigning a snapshot to it copies the cells without allocating.
+	std::vector<std::unique_ptr<ConsensusArray>> workers;
+	for(int thread = 0; thread < m_threadCount; ++thread)
+	{
+		workers.emplace_back(new ConsensusArray(LatticeStorage(m_rows * m_cols), m_rows, m_cols, m_p1, m_p2, m_layout, m_tileSize));
+	}
+
+	std::vector<Entrance> entrances;
+	std::vector<Entrance> crossings(static_cast<std::size_t>(m_trials));
+	std::vector<long long> successes;
+
+	for(std::size_t level = 0; level < m_levels.size(); ++level)
+	{
+		double threshold = m_levels[level];
+		std::atomic<long long> nextTrial(0);
+
+		parallelFor(m_threadCount, m_threadCount, 1, [&](int thread, long long, long long) {
+			ConsensusArray &lattice = *workers[thread];
+
+			// Trials take very different times, so each thread takes the next trial when it is free.
+			for(long long trial = nextTrial++; trial < m_trials; trial = nextTrial++)
+			{
+				std::uint64_t stream = (static_cast<std::uint64_t>(repetition) << 48) + (static_cast<std::uint64_t>(level) << 32) + static_cast<std::uint64_t>(trial);
+				std::uint64_t bits = counterRandom(m_seed, stream);
+				std::seed_seq seeds{static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits)};
+				std::default_random_engine generator(seeds);
+
+				// The first level starts from fresh lattices, the others from a random entrance of the level below.
+				int sweep = 0;
+				if(0 == level)
+				{
+					LatticeInitialiser(generator, 1).random(lattice);
+				}
+				else
+				{
+					const Entrance &entrance = entrances[scaleRandom(static_cast<std::uint32_t>(bits), static_cast<std::uint32_t>(entrances.size()))];
+					lattice = *entrance.lattice;
+					sweep = entrance.sweep;
+				}
+
+				while(majorityFraction(lattice) < threshold && sweep < m_maxSweeps)
+				{
+					lattice.sweep(generator);
+					++sweep;
+				}
+
+				bool crossed = majorityFraction(lattice) >= threshold;
+				crossings[trial] = Entrance{(crossed && level + 1 < m_levels.size()) ? pool.take(lattice) : nullptr, crossed ? sweep : -1};
+			}
+		});
+
+		for(const Entrance &entrance : entrances)
+		{
+			pool.release(entrance.lattice);
+		}
+		entrances.clear();
+
+		// Keep the crossings in trial order, so the entrances do not depend on which thread finished first.
+		long long crossed = 0;
+		for(const Entrance &crossing : crossings)
+		{
+			crossed += (crossing.sweep >= 0);
+			if(crossing.lattice)
+			{
+				entrances.push_back(crossing);
+			}
+		}
+		successes.push_back(crossed);
+
+		progress << "repetition " << repetition << " level " << level << " (" << threshold << "): "
+		         << crossed << '/' << m_trials << " crossed\n";
+
+		if(0 == crossed)
+		{
+			break;
+		}
+	}
+
+	for(const Entrance &entrance : entrances)
+	{
+		pool.release(entrance.lattice);
+	}
+	return successes;
+}
+
+void SplittingSampler::run(int repetitions, std::ostream &progress)
+{
+	// Entrances of one level and crossings of the next exist at once, so the pool never makes a thread wait.
+	LatticeSnapshotPool pool(static_cast<std::size_t>(2 * m_trials));
+
+	for(int repetition = 0; repetition < repetitions; ++repetition)
+	{
+		m_successes.push_back(runRepetition(static_cast<int>(m_successes.size()), pool, progress));
+	}
+}
+
+double SplittingSampler::estimate(int repetition) const
+{
+	const std::vector<long long> &successes = m_successes[repetition];
+
+	double probability = 1;
+	for(std::size_t level = 0; level < m_levels.size(); ++level)
+	{
+		probability *= (level < successes.size()) ? static_cast<double>(successes[level]) / m_trials : 0;
+	}
+	return probability;
+}
+
+double SplittingSampler::probability() const
+{
+	double total = 0;
+	for(std::size_t repetition = 0; repetition < m_successes.size(); ++repetition)
+	{
+		total += estimate(static_cast<int>(repetition));
+	}
+	return m_successes.empty() ? std::numeric_limits<double>::quiet_NaN() : total / m_successes.size();
+}
+
+double SplittingSampler::error() const
+{
+	std::size_t repetitions = m_successes.size();
+	if(repetitions < 2)
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	double mean = probability();
+	double squares = 0;
+	for(std::size_t repetition = 0; repetition < repetitions; ++repetition)
+	{
+		double deviation = estimate(static_cast<int>(repetition)) - mean;
+		squares += deviation * deviation;
+	}
+	return std::sqrt(squares / (repetitions - 1) / repetitions);
+}
+
+void SplittingSampler::writeSummary(std::ostream &out) const
+{
+	for(std::size_t level = 0; level < m_levels.size(); ++level)
+	{
+		long long trials = 0;
+		long long successes = 0;
+		for(const auto &repetition : m_successes)
+		{
+			if(level < repetition.size())
+			{
+				trials += m_trials;
+				successes += repetition[level];
+			}
+		}
+
+		out << level << ' ' << m_levels[level] << ' ' << trials << ' ' << successes << ' '
+		    << (trials > 0 ? static_cast<double>(successes) / trials : std::numeric_limits<double>::quiet_NaN()) << '\n';
+	}
+
+	out << "\n\n";
+	for(std::size_t repetition = 0; repetition < m_successes.size(); ++repetition)
+	{
+		out << repetition << ' ' << estimate(static_cast<int>(repetition)) << '\n';
+	}
+
+	out << "\n\n" << m_p1 << ' ' << m_p2 << ' ' << probability() << ' ' << error() << '\n';
+}
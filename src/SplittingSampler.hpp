@@ -0,0 +1,151 @@
+#ifndef SplittingSampler_hpp
+#define SplittingSampler_hpp
+
+#include <vector> // For the levels and estimates.
+#include <iostream> // For the output tables.
+#include <cstdint> // For the seed.
+#include "ConsensusArray.hpp"
+#include "LatticeSnapshotPool.hpp"
+
+/**
+ *\file
+ *\class SplittingSampler
+ *\brief Class that estimates small probabilities of reaching consensus by fixed-effort multilevel splitting.
+ *
+ * The probability that a randomly initialised lattice reaches consensus within a number of sweeps is
+ * written as a product of conditional probabilities of climbing from one level of the majority
+ * fraction (the fraction of the most common species) to the next, with the last level 1 being
+ * consensus. A fixed number of trials is run at every level: the trials of the first level start
+ * from fresh random lattices, those of each later level from a lattice, chosen at random, in the
+ * state some trial of the level before was in when it first crossed that level, keeping the sweep
+ * it crossed at. A trial succeeds when it crosses the next level and fails when it runs out of
+ * sweeps. Each conditional probability is then of order 0.1 to 0.5, so a probability of 10^-6 needs
+ * about ten levels of a thousand trials instead of millions of replicas.
+ *
+ * The product of the fractions of successful trials is an unbiased estimate. Its error is taken from
+ * the spread of independent repetitions, which unlike a per-level binomial estimate includes the
+ * correlations between trials started from the same lattice.
+ *
+ * Lattice states are copied into snapshots from a LatticeSnapshotPool, so once the first two levels
+ * are done no cells are allocated; the pool holds at most two levels' worth of lattices. Trials run
+ * on a pool of threads, each with its own working lattice, taking trials in turn, and every trial
+ * seeds its generator from the sampler's seed, the repetition, the level and the trial number, so
+ * results do not depend on the number of threads.
+ */
+class SplittingSampler
+{
+private:
+	/// Member variable that holds the number of rows of the lattice.
+	long long m_rows;
+
+	/// Member variable that holds the number of columns of the lattice.
+	long long m_cols;
+
+	/// Member variable that holds the probability of a cyclic invasion.
+	double m_p1;
+
+	/// Member variable that holds the probability of an anti-cyclic invasion.
+	double m_p2;
+
+	/// Member variable that holds the memory layout of the lattice.
+	ConsensusArray::Layout m_layout;
+
+	/// Member variable that holds the side of a tile.
+	int m_tileSize;
+
+	/// Member variable that holds the increasing majority fractions of the levels, the last being 1.
+	std::vector<double> m_levels;
+
+	/// Member variable that holds the number of trials run at each level.
+	long long m_trials;
+
+	/// Member variable that holds the sweeps after which a trial fails.
+	int m_maxSweeps;
+
+	/// Member variable that holds the number of threads.
+	int m_threadCount;
+
+	/// Member variable that holds the seed every trial's generator is derived from.
+	std::uint64_t m_seed;
+
+	/// Member variable that holds the successful trials of each level of each repetition.
+	std::vector<std::vector<long long>> m_successes;
+
+	/**
+	 *\brief Runs one repetition of every level.
+	 *\param repetition number of the repetition.
+	 *\param pool pool the entrance states are copied into.
+	 *\param progress stream a line is written to after each level.
+	 *\return the successful trials of each level, ending early if a level has none.
+	 */
+	std::vector<long long> runRepetition(int repetition, LatticeSnapshotPool &pool, std::ostream &progress) const;
+
+public:
+	/**
+	 *\brief Constructor, throws std::invalid_argument if the levels are not increasing within (0, 1].
+	 *\param rows number of rows of the lattice.
+	 *\param cols number of columns of the lattice.
+	 *\param p1 probability of a cyclic invasion.
+	 *\param p2 probability of an anti-cyclic invasion.
+	 *\param layout memory layout of the lattice.
+	 *\param tileSize side of a tile in a tiled layout.
+	 *\param levels increasing majority fractions, 1 is added as the last level if missing.
+	 *\param trials number of trials run at each level.
+	 *\param maxSweeps sweeps from the start of a trajectory after which it has failed.
+	 *\param threadCount number of threads running trials.
+	 *\param seed seed of the trial generators.
+	 */
+	SplittingSampler(long long rows, long long cols, double p1, double p2, ConsensusArray::Layout layout, int tileSize,
+		std::vector<double> levels, long long trials, int maxSweeps, int threadCount, std::uint64_t seed);
+
+	/**
+	 *\brief Evenly spaced levels from first up to and including 1.
+	 *\param first majority fraction of the first level.
+	 *\param count number of levels.
+	 *\return the levels.
+	 */
+	static std::vector<double> evenLevels(double first, int count);
+
+	/**
+	 *\brief Calculates the order parameter, the fraction of the lattice held by the most common species.
+	 *\param lattice the lattice.
+	 *\return Floating point value representing the majority fraction.
+	 */
+	static double majorityFraction(const ConsensusArray &lattice);
+
+	/**
+	 *\brief Runs independent repetitions of the whole splitting.
+	 *\param repetitions number of repetitions, at least 2 gives an error bar.
+	 *\param progress stream a line is written to after each level.
+	 */
+	void run(int repetitions, std::ostream &progress);
+
+	/**
+	 *\brief Estimate of one repetition, the product of its conditional probabilities.
+	 *\param repetition number of the repetition.
+	 *\return the estimated probability.
+	 */
+	double estimate(int repetition) const;
+
+	/**
+	 *\brief Mean of the repetitions' estimates.
+	 *\return the estimated probability of consensus within the maximum sweeps.
+	 */
+	double probability() const;
+
+	/**
+	 *\brief Standard error of the mean of the repetitions' estimates.
+	 *\return the error, NaN with fewer than two repetitions.
+	 */
+	double error() const;
+
+	/**
+	 *\brief Writes three blocks, separated by two blank lines so gnuplot can select them with index: one line per
+	 * level (level, majority fraction, trials, successes, conditional probability, over every repetition), one line
+	 * per repetition (repetition, estimate) and a final line of p_1, p_2, probability and error.
+	 *\param out std::ostream reference for the table.
+	 */
+	void writeSummary(std::ostream &out) const;
+};
+
+#endif /* SplittingSampler_hpp */
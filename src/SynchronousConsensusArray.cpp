@@ -0,0 +1,222 @@
+#include "SynchronousConsensusArray.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+
+const int SynchronousConsensusArray::countEntries;
+
+namespace
+{
+	/// Rows worth giving a thread are at least this many cells in total.
+	const long long cellGrain = 1LL << 16;
+
+	/// Converts a probability into a threshold that a 32 bit random number is below with that probability.
+	std::uint64_t acceptanceThreshold(double probability)
+	{
+		const double scale = 4294967296.0;
+		return (probability <= 0) ? 0 : (probability >= 1) ? static_cast<std::uint64_t>(scale) : static_cast<std::uint64_t>(probability * scale);
+	}
+
+	/// Next state of a cell given its four neighbours and its random number, branch free so that a row vectorises.
+	inline ConsensusModel::State pullState(
+		ConsensusModel::State cell,
+		ConsensusModel::State right,
+		ConsensusModel::State down,
+		ConsensusModel::State left,
+		ConsensusModel::State up,
+		std::uint64_t bits,
+		std::uint64_t cyclic,
+		std::uint64_t antiCyclic)
+	{
+		// The low two bits pick the neighbour in the same order as moveToNeighbour().
+		unsigned choice = static_cast<unsigned>(bits & 3);
+		ConsensusModel::State neighbour = (0 == choice) ? right : (1 == choice) ? down : (2 == choice) ? left : up;
+
+		// The neighbour invades cyclically if the cell is one state on from it, and anti-cyclically if two.
+		int difference = static_cast<int>(cell) - static_cast<int>(neighbour);
+		difference += (difference < 0) ? 3 : 0;
+		std::uint64_t threshold = (1 == difference) ? cyclic : (2 == difference) ? antiCyclic : 0;
+
+		return ((bits >> 32) < threshold) ? neighbour : cell;
+	}
+
+	/// Next states of the columns [1, cols - 1) of a row, which have all their neighbours in the same three rows.
+	/// The 64 bit multiplies of the random numbers only vectorise well with AVX2, so that version is
+	/// chosen at run time where the processor has it.
+	__attribute__((target_clones("avx2", "default")))
+	void pullInterior(
+		const ConsensusModel::State *up,
+		const ConsensusModel::State *here,
+		const ConsensusModel::State *down,
+		ConsensusModel::State *out,
+		long long cols,
+		std::uint64_t key,
+		std::uint64_t first,
+		std::uint64_t cyclic,
+		std::uint64_t antiCyclic)
+	{
+		for(long long col = 1; col < cols - 1; ++col)
+		{
+			out[col] = pullState(here[col], here[col + 1], down[col], here[col - 1], up[col], counterRandom(key, first + col), cyclic, antiCyclic);
+		}
+	}
+
+	/// Adds the bonds between first[i] and second[i] for i in [0, count) to the bond counts, ordered as pairIndices.
+	void countBonds(const ConsensusModel::State *first, const ConsensusModel::State *second, long long count, long long *bonds)
+	{
+		// Separate 32 bit counters for each pair rather than an indexed increment, so the loop
+		// vectorises without widening every byte to 64 bits. A row has fewer than 2^32 cells.
+		std::uint32_t redRed = 0, greenGreen = 0, redGreen = 0, redBlue = 0, greenBlue = 0;
+		for(long long i = 0; i < count; ++i)
+		{
+			int a = first[i];
+			int b = second[i];
+			int sum = a + b;
+			bool unlike = a != b;
+			redRed     += (0 == sum);
+			greenGreen += !unlike && (2 == sum);
+			redGreen   += (1 == sum);
+			redBlue    += unlike && (2 == sum);
+			greenBlue  += (3 == sum);
+		}
+
+		bonds[0] += redRed;
+		bonds[1] += redGreen;
+		bonds[2] += redBlue;
+		bonds[3] += greenGreen;
+		bonds[4] += greenBlue;
+		bonds[5] += count - static_cast<long long>(redRed) - greenGreen - redGreen - redBlue - greenBlue;
+	}
+}
+
+SynchronousConsensusArray::SynchronousConsensusArray(
+	LatticeStorage &&storage,
+	long long rows,
+	long long cols,
+	double prob1,
+	double prob2,
+	int threadCount) :
+	ConsensusArray(std::move(storage), rows, cols, prob1, prob2, ConsensusArray::RowMajor),
+	m_next(rows * cols),
+	m_threadCount{threadCount > 0 ? threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))},
+	m_partialCounts(static_cast<std::size_t>(m_threadCount))
+{
+	if(getStorage().isMapped())
+	{
+		throw std::invalid_argument("A synchronous lattice must be held in memory.");
+	}
+}
+
+void SynchronousConsensusArray::pullRow(long long row, std::uint64_t key, std::uint64_t cyclic, std::uint64_t antiCyclic, ConsensusArray::State *out) const
+{
+	long long rows = getRows();
+	long long cols = getCols();
+	const ConsensusArray::State *cells = getStorage().data();
+	const ConsensusArray::State *up = cells + ((0 == row) ? rows - 1 : row - 1) * cols;
+	const ConsensusArray::State *here = cells + row * cols;
+	const ConsensusArray::State *down = cells + ((row + 1 == rows) ? 0 : row + 1) * cols;
+	std::uint64_t first = static_cast<std::uint64_t>(row * cols);
+
+	// The first and last columns wrap around, the ones between vectorise.
+	auto edge = [&](long long col) {
+		long long left = (0 == col) ? cols - 1 : col - 1;
+		long long right = (col + 1 == cols) ? 0 : col + 1;
+		out[col] = pullState(here[col], here[right], down[col], here[left], up[col], counterRandom(key, first + col), cyclic, antiCyclic);
+	};
+
+	edge(0);
+	if(cols > 2)
+	{
+		pullInterior(up, here, down, out, cols, key, first, cyclic, antiCyclic);
+	}
+	if(cols > 1)
+	{
+		edge(cols - 1);
+	}
+}
+
+void SynchronousConsensusArray::sweep(std::default_random_engine& generator)
+{
+	// One key per sweep, every cell's numbers are then fixed by its position.
+	std::uint64_t key = (static_cast<std::uint64_t>(generator()) << 32) ^ generator();
+	std::uint64_t cyclic = acceptanceThreshold(getp1());
+	std::uint64_t antiCyclic = acceptanceThreshold(getp2());
+
+	long long rows = getRows();
+	long long cols = getCols();
+	ConsensusArray::State *next = m_next.data();
+	std::fill(m_partialCounts.begin(), m_partialCounts.end(), std::array<long long, countEntries>());
+
+	parallelFor(m_threadCount, rows, std::max(1LL, cellGrain / std::max(1LL, cols)),
+		[&](int thread, long long firstRow, long long lastRow) {
+			// Counted on the worker's own stack, away from what other threads write, and stored once at the end.
+			std::array<long long, countEntries> counts{};
+			long long *bonds = counts.data() + MAXSTATE;
+
+			for(long long row = firstRow; row < lastRow; ++row)
+			{
+				ConsensusArray::State *out = next + row * cols;
+				pullRow(row, key, cyclic, antiCyclic, out);
+
+				std::uint32_t red = 0, green = 0;
+				for(long long col = 0; col < cols; ++col)
+				{
+					red += (ConsensusModel::Red == out[col]);
+					green += (ConsensusModel::Green == out[col]);
+				}
+				counts[ConsensusModel::Red] += red;
+				counts[ConsensusModel::Green] += green;
+				counts[ConsensusModel::Blue] += cols - static_cast<long long>(red) - green;
+
+				// Bonds to the right, a lattice one cell wide has no bond from a cell to itself.
+				if(cols > 1)
+				{
+					countBonds(out, out + 1, cols - 1, bonds);
+					countBonds(out + cols - 1, out, 1, bonds);
+				}
+
+				// Bonds down from the previous row, which is still in cache.
+				if(row > firstRow)
+				{
+					countBonds(out - cols, out, cols, bonds);
+				}
+			}
+
+			// The row below the block belongs to another thread, so compute its next states again
+			// rather than wait for them. They are the same numbers from the same counters.
+			if(rows > 1)
+			{
+				long long below = (lastRow == rows) ? 0 : lastRow;
+				const ConsensusArray::State *belowRow = next + below * cols;
+				std::vector<ConsensusArray::State> halo;
+				if(below < firstRow || below >= lastRow)
+				{
+					halo.resize(static_cast<std::size_t>(cols));
+					pullRow(below, key, cyclic, antiCyclic, halo.data());
+					belowRow = halo.data();
+				}
+				countBonds(next + (lastRow - 1) * cols, belowRow, cols, bonds);
+			}
+
+			m_partialCounts[thread] = counts;
+		});
+
+	std::swap(getStorage(), m_next);
+
+	long long stateCounts[MAXSTATE] = {};
+	long long bondCounts[MAXSTATE * (MAXSTATE + 1) / 2] = {};
+	for(const auto &counts : m_partialCounts)
+	{
+		for(int state = 0; state < MAXSTATE; ++state)
+		{
+			stateCounts[state] += counts[state];
+		}
+		for(int pair = 0; pair < MAXSTATE * (MAXSTATE + 1) / 2; ++pair)
+		{
+			bondCounts[pair] += counts[MAXSTATE + pair];
+		}
+	}
+	setCounts(stateCounts, bondCounts);
+}
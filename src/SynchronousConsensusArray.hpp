@@ -0,0 +1,86 @@
+#ifndef SynchronousConsensusArray_hpp
+#define SynchronousConsensusArray_hpp
+
+#include <vector> // For the per-thread counts.
+#include <array> // For the counts of one thread.
+#include <cstdint> // For the acceptance thresholds.
+#include "ConsensusArray.hpp"
+
+/**
+ *\file
+ *\class SynchronousConsensusArray
+ *\brief Class for a 2D lattice updated synchronously, as a cellular automaton, instead of one random site at a time.
+ *
+ * In a synchronous sweep every cell picks one of its four neighbours at once and is invaded by it,
+ * with the usual p_1 or p_2, using only the states before the sweep. This is the pull form of the
+ * random sequential update in ConsensusArray::update(), where a cell pushes its state onto a
+ * neighbour: it is a different process, with the same absorbing states, that is acceptable for some
+ * studies and much faster for all of them.
+ *
+ * The new states are written to a second buffer that is swapped with the cells after the sweep. The
+ * random numbers of a cell are a counter-based function of a key drawn once per sweep and the cell's
+ * position (see CounterRandom.hpp), so the row loops have no dependencies between cells and
+ * vectorise, rows are split between threads in blocks, and the lattice after a sweep depends only on
+ * the seed, not on the number of threads. Species and bond counts are taken from each new row while
+ * it is still in cache rather than by another pass over the lattice.
+ *
+ * Only the row major layout is supported: a synchronous sweep reads rows in order so tiles would not
+ * help. The lattice must be held in memory, since the cells alternate between the two buffers.
+ */
+class SynchronousConsensusArray : public ConsensusArray
+{
+private:
+	/// Number of entries in the counts of one thread, the species followed by the bonds.
+	static const int countEntries = MAXSTATE + MAXSTATE * (MAXSTATE + 1) / 2;
+
+	/// Member variable that holds the buffer the next states are written to.
+	LatticeStorage m_next;
+
+	/// Member variable that holds the maximum number of threads a sweep uses.
+	int m_threadCount;
+
+	/// Member variable that holds the counts of each thread, reused between sweeps.
+	std::vector<std::array<long long, countEntries>> m_partialCounts;
+
+	/**
+	 *\brief Computes the next states of one row.
+	 *\param row row index in [0, #rows).
+	 *\param key key of this sweep's random stream.
+	 *\param cyclic acceptance threshold of a cyclic invasion, a 32 bit number below it accepts.
+	 *\param antiCyclic acceptance threshold of an anti-cyclic invasion.
+	 *\param out #columns cells the next states are written to.
+	 */
+	void pullRow(long long row, std::uint64_t key, std::uint64_t cyclic, std::uint64_t antiCyclic, ConsensusArray::State *out) const;
+
+public:
+	/**
+	 *\brief Constructor that takes over existing cells.
+	 *
+	 * Throws std::invalid_argument if the storage is a mapped file.
+	 *
+	 *\param storage cells of the lattice in row major order, must hold rows*cols cells.
+	 *\param rows number of rows on the board.
+	 *\param cols number of columns on the board.
+	 *\param prob1 probability of a cyclic invasion.
+	 *\param prob2 probability of an anti-cyclic invasion.
+	 *\param threadCount number of threads a sweep uses, 0 uses every hardware thread.
+	 */
+	SynchronousConsensusArray(
+		LatticeStorage &&storage,
+		long long rows,
+		long long cols,
+		double prob1 = 1.0,
+		double prob2 = 1.0,
+		int threadCount = 0);
+
+	SynchronousConsensusArray(const SynchronousConsensusArray&) = delete;
+	SynchronousConsensusArray& operator=(const SynchronousConsensusArray&) = delete;
+
+	/**
+	 *\brief Performs one synchronous sweep, updating every cell once from the previous states.
+	 *\param generator std::default_random_engine reference the key of the sweep is drawn from.
+	 */
+	void sweep(std::default_random_engine& generator) override;
+};
+
+#endif /* SynchronousConsensusArray_hpp */
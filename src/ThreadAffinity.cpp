@@ -0,0 +1,207 @@
+#include "ThreadAffinity.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+	/// The process wide policy used by parallelFor workers.
+	ThreadAffinity processAffinity;
+
+	/// Worker number the calling thread was pinned as by pinWorker(), -1 if it was not.
+	thread_local int currentWorker = -1;
+
+	/// Parses one cpu number, -1 unless it is made only of digits and below CPU_SETSIZE.
+	int parseCpu(const std::string &digits)
+	{
+		if(digits.empty() || digits.size() > 6 || digits.find_first_not_of("0123456789") != std::string::npos)
+		{
+			return -1;
+		}
+
+		int cpu = std::stoi(digits);
+		return (cpu < CPU_SETSIZE) ? cpu : -1;
+	}
+}
+
+ThreadAffinity::ThreadAffinity(const std::string &policy)
+{
+	if("none" == policy || policy.empty())
+	{
+		return;
+	}
+
+	std::vector<std::vector<int>> nodes = numaNodes();
+	if("compact" == policy)
+	{
+		for(const auto &node : nodes)
+		{
+			m_cpus.insert(m_cpus.end(), node.begin(), node.end());
+		}
+	}
+	else if("scatter" == policy)
+	{
+		std::size_t largestNode = 0;
+		for(const auto &node : nodes)
+		{
+			largestNode = std::max(largestNode, node.size());
+		}
+
+		for(std::size_t position = 0; position < largestNode; ++position)
+		{
+			for(const auto &node : nodes)
+			{
+				if(position < node.size())
+				{
+					m_cpus.push_back(node[position]);
+				}
+			}
+		}
+	}
+	else
+	{
+		m_cpus = parseCpuList(policy);
+		if(m_cpus.empty())
+		{
+			throw std::invalid_argument("Unknown affinity policy: " + policy + ", expected none, compact, scatter or a cpu list such as 0-7,16-23.");
+		}
+	}
+}
+
+bool ThreadAffinity::pin(int thread) const
+{
+	if(m_cpus.empty())
+	{
+		return false;
+	}
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu(thread), &cpus);
+	return 0 == pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+int ThreadAffinity::cpu(int thread) const
+{
+	return m_cpus.empty() ? -1 : m_cpus[static_cast<std::size_t>(thread) % m_cpus.size()];
+}
+
+std::vector<std::vector<int>> ThreadAffinity::numaNodes()
+{
+	std::vector<std::vector<int>> nodes;
+	for(int node = 0; ; ++node)
+	{
+		std::ifstream cpuListInput("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		if(!cpuListInput)
+		{
+			break;
+		}
+
+		std::string list;
+		std::getline(cpuListInput, list);
+		std::vector<int> cpus = parseCpuList(list);
+		if(!cpus.empty())
+		{
+			nodes.push_back(cpus);
+		}
+	}
+
+	// Without NUMA information every cpu this process may use is on one node.
+	if(nodes.empty())
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		nodes.emplace_back();
+		if(0 == sched_getaffinity(0, sizeof(allowed), &allowed))
+		{
+			for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			{
+				if(CPU_ISSET(cpu, &allowed))
+				{
+					nodes.back().push_back(cpu);
+				}
+			}
+		}
+		else
+		{
+			for(unsigned int cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+			{
+				nodes.back().push_back(static_cast<int>(cpu));
+			}
+		}
+	}
+
+	return nodes;
+}
+
+std::vector<int> ThreadAffinity::parseCpuList(const std::string &list)
+{
+	std::vector<int> cpus;
+	std::stringstream ranges(list);
+	std::string range;
+	while(std::getline(ranges, range, ','))
+	{
+		// Each entry is a cpu or an increasing range of cpus, every cpu below CPU_SETSIZE.
+		std::size_t dash = range.find('-');
+		int first = parseCpu(range.substr(0, dash));
+		int last = (std::string::npos == dash) ? first : parseCpu(range.substr(dash + 1));
+		if(first < 0 || last < first)
+		{
+			return {};
+		}
+
+		for(int cpu = first; cpu <= last; ++cpu)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+void ThreadAffinity::restrictToNode(int thread)
+{
+	int home = processAffinity.cpu(thread);
+	if(home < 0)
+	{
+		return;
+	}
+
+	for(const auto &node : numaNodes())
+	{
+		if(std::find(node.begin(), node.end(), home) != node.end())
+		{
+			std::vector<int> &cpus = processAffinity.m_cpus;
+			cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&node](int cpu) {
+				return std::find(node.begin(), node.end(), cpu) == node.end();
+			}), cpus.end());
+			return;
+		}
+	}
+}
+
+void ThreadAffinity::setPolicy(const std::string &policy)
+{
+	processAffinity = ThreadAffinity(policy);
+}
+
+bool ThreadAffinity::isPinning()
+{
+	return processAffinity.cpu(0) >= 0;
+}
+
+void ThreadAffinity::pinWorker(int thread)
+{
+	if(processAffinity.pin(thread))
+	{
+		currentWorker = thread;
+	}
+}
+
+int ThreadAffinity::worker()
+{
+	return currentWorker;
+}
@@ -0,0 +1,99 @@
+#ifndef ThreadAffinity_hpp
+#define ThreadAffinity_hpp
+
+#include <string> // For the policy.
+#include <vector> // For the cpu lists.
+
+/**
+ *\file
+ *\class ThreadAffinity
+ *\brief Class that pins worker threads to cpus so that memory they touch first stays on their NUMA node.
+ *
+ * Linux places a page on the NUMA node of the thread that first writes to it. The lattice is
+ * filled by the same parallelFor chunks that later work on it, so pinning worker i to the same cpu
+ * every time keeps each chunk in the memory of the socket that uses it, instead of the whole
+ * lattice landing on one node and every other socket reading it across the interconnect.
+ *
+ * The process wide policy is one of
+ *  - "none": threads are not pinned (the default),
+ *  - "compact": worker i runs on the i'th cpu, filling one NUMA node before the next,
+ *  - "scatter": workers are dealt round robin over the NUMA nodes,
+ *  - a cpu list such as "0-7,16-23": worker i runs on the i'th cpu of the list.
+ * Worker numbers beyond the number of cpus wrap around.
+ */
+class ThreadAffinity
+{
+private:
+	/// Member variable that holds the cpu of each worker, empty when threads are not pinned.
+	std::vector<int> m_cpus;
+
+public:
+	/**
+	 *\brief Constructor, throws std::invalid_argument for a policy it does not recognise.
+	 *\param policy "none", "compact", "scatter" or a cpu list.
+	 */
+	explicit ThreadAffinity(const std::string &policy = "none");
+
+	/**
+	 *\brief Pins the calling thread to the cpu of a worker.
+	 *\param thread worker number.
+	 *\return true if the thread was pinned, false if the policy is "none" or pinning failed.
+	 */
+	bool pin(int thread) const;
+
+	/**
+	 *\brief Getter for the cpu of a worker.
+	 *\param thread worker number.
+	 *\return the cpu, or -1 if threads are not pinned.
+	 */
+	int cpu(int thread) const;
+
+	/**
+	 *\brief Getter for the cpus of each NUMA node, read from sysfs.
+	 *\return the cpus of every node, a single node holding every cpu if there is no NUMA information.
+	 */
+	static std::vector<std::vector<int>> numaNodes();
+
+	/**
+	 *\brief Parses a cpu list such as "0-3,8,10-11".
+	 *\param list the cpu list.
+	 *\return the cpus in the order listed, empty if any entry is not a cpu or an increasing range of cpus.
+	 */
+	static std::vector<int> parseCpuList(const std::string &list);
+
+	/**
+	 *\brief Sets the policy used by pinWorker(), throws std::invalid_argument for a policy it does not recognise.
+	 *\param policy "none", "compact", "scatter" or a cpu list.
+	 */
+	static void setPolicy(const std::string &policy);
+
+	/**
+	 *\brief Tells whether the process wide policy pins threads.
+	 *\return true unless the policy is "none".
+	 */
+	static bool isPinning();
+
+	/**
+	 *\brief Pins the calling thread to the cpu of a worker under the process wide policy.
+	 *\param thread worker number.
+	 */
+	static void pinWorker(int thread);
+
+	/**
+	 *\brief Getter for the worker number the calling thread was pinned as.
+	 *\return the number passed to pinWorker(), or -1 if the thread is not pinned.
+	 */
+	static int worker();
+
+	/**
+	 *\brief Keeps only the cpus of the process wide policy that are on the NUMA node of a worker.
+	 *
+	 * Used when one thread does all the work on memory that several threads fill: pinned to that
+	 * worker's cpu, it then reads pages first touched on its own node instead of spread over the nodes.
+	 *
+	 *\param thread worker number.
+	 */
+	static void restrictToNode(int thread);
+};
+
+#endif /* ThreadAffinity_hpp */
@@ -1,4 +1,21 @@
 #include "ConsensusArray.hpp"
+#include "DisorderedConsensusArray.hpp"
+#include "SynchronousConsensusArray.hpp"
+#include "MeanFieldConsensus.hpp"
+#include "ConsensusGraph.hpp"
+#include "HypercubicLattice.hpp"
+#include "LatticeInitialiser.hpp"
+#include "FrameRenderer.hpp"
+#include "SharedLatticeView.hpp"
+#include "MeasurementExecutor.hpp"
+#include "FractionObservable.hpp"
+#include "ClusterObservable.hpp"
+#include "CorrelationObservable.hpp"
+#include "Continuation.hpp"
+#include "EnsembleDriver.hpp"
+#include "SplittingSampler.hpp"
+#include "ThreadAffinity.hpp"
+#include "PhaseProfiler.hpp"
 #include "getTimeStamp.hpp"
 #include "makeDirectory.hpp"
 #include "ConsensusInputParameters.hpp"
@@ -9,12 +26,17 @@
 #include <random>
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
 #include <thread>
 #include <chrono>
 #include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <memory>
+#include <functional>
+#include <stdexcept>
 
 int main(int argc, char const *argv[])
 {
@@ -32,12 +54,56 @@ int main(int argc, char const *argv[])
     std::default_random_engine generator(seed);
 
     // Input parameters.
-    int rowCount;
-    int colCount;
+    long long rowCount;
+    long long colCount;
     double p_1;
     double p_2;
     int totalSweeps;
     int measurementInterval;
+    long long population;
+    double tau;
+    std::string graphType;
+    int degree;
+    double rewireProbability;
+    std::string edgeListName;
+    int dimension;
+    long long length;
+    long long slicePosition;
+    std::string layoutName;
+    int tileSize;
+    std::string mappedLatticeName;
+    std::string initialCondition;
+    std::vector<double> initialFractions;
+    long long stripeWidth;
+    long long domainSize;
+    std::string initialLatticeName;
+    int threadCount;
+    int frameInterval;
+    long long frameBlock;
+    long long frameSize;
+    std::string sharedMemoryName;
+    int viewInterval;
+    int measureThreads;
+    long long correlationDistance;
+    std::vector<double> scanP1;
+    std::vector<double> scanP2;
+    int equilibrationSweeps;
+    int measurementSweeps;
+    double targetError;
+    long long maxReplicas;
+    int batchSize;
+    int histogramBins;
+    std::vector<double> splittingLevels;
+    int levelCount;
+    long long trialCount;
+    int repetitionCount;
+    double zealotFraction;
+    std::vector<double> classRates;
+    std::vector<double> classFractions;
+    std::string siteFileName;
+    std::string affinity;
+    double stopDensity;
+    int prefetchDistance;
     std::string outputName;
 
     // Set up optional command line arguments.
@@ -46,13 +112,67 @@ int main(int argc, char const *argv[])
     // Add all optional command line arguments.
     desc.add_options()
 
-        ("column-count,c", boost::program_options::value<int>(&rowCount)->default_value(50), "The number of rows in the lattice.")
-        ("row-count,r", boost::program_options::value<int>(&colCount)->default_value(50), "The number of columns in the lattice.")
+        ("column-count,c", boost::program_options::value<long long>(&rowCount)->default_value(50), "The number of rows in the lattice.")
+        ("row-count,r", boost::program_options::value<long long>(&colCount)->default_value(50), "The number of columns in the lattice.")
         ("p_1,p", boost::program_options::value<double>(&p_1)->default_value(1), "Value of p_1 in simulation.")
         ("p_2,q", boost::program_options::value<double>(&p_2)->default_value(1), "Value of p_2 in simulation.")
         ("sweeps,s", boost::program_options::value<int>(&totalSweeps)->default_value(10000), "The number of sweeps in the simulation.")
+        ("measurement-interval", boost::program_options::value<int>(&measurementInterval)->default_value(10), "The number of sweeps between measurements.")
         ("output,o",boost::program_options::value<std::string>(&outputName)->default_value(getTimeStamp()), "Name of output directory to save output files into.")
         ("animate,a","Animate the program by printing the current state of the lattice to an output file during simulation")
+        ("mean-field,m","Simulate a well-mixed population that only tracks species counts instead of a lattice")
+        ("population,N", boost::program_options::value<long long>(&population)->default_value(0), "Population size of the mean-field simulation, defaults to rows*columns.")
+        ("tau", boost::program_options::value<double>(&tau)->default_value(0), "Tau-leaping step in sweeps for the mean-field simulation, 0 uses the exact Gillespie algorithm.")
+        ("graph,g", boost::program_options::value<std::string>(&graphType), "Simulate on a network instead of the lattice: square, regular, small-world or file.")
+        ("degree,k", boost::program_options::value<int>(&degree)->default_value(4), "Degree of the regular or small-world network.")
+        ("rewire", boost::program_options::value<double>(&rewireProbability)->default_value(0.1), "Rewiring probability of the small-world network.")
+        ("edge-list", boost::program_options::value<std::string>(&edgeListName), "Edge list file to load when the network type is file.")
+        ("no-reorder", "Keep the network's vertex labels instead of relabelling them for memory locality.")
+        ("dimension,d", boost::program_options::value<int>(&dimension)->default_value(2), "Dimension of the hypercubic lattice, 1 to 4.")
+        ("length,L", boost::program_options::value<long long>(&length)->default_value(0), "Side length of a hypercubic lattice that is not 2D, defaults to the number of rows.")
+        ("layout", boost::program_options::value<std::string>(&layoutName)->default_value("rowmajor"), "Memory layout of the 2D lattice: rowmajor, or tiled which also sweeps tile by tile.")
+        ("tile-size", boost::program_options::value<int>(&tileSize)->default_value(64), "Side of a tile in the tiled layout, a power of two dividing the rows and columns.")
+        ("mmap-file", boost::program_options::value<std::string>(&mappedLatticeName), "Hold the 2D lattice in this memory-mapped file instead of RAM, best combined with a tiled layout.")
+        ("init", boost::program_options::value<std::string>(&initialCondition)->default_value("random"), "Initial condition of the 2D lattice: random, biased, stripes, domains, file, or keep to carry on from an existing --mmap-file.")
+        ("init-fractions", boost::program_options::value<std::vector<double>>(&initialFractions)->multitoken(), "Expected red, green and blue fractions of a biased initial condition.")
+        ("stripe-width", boost::program_options::value<long long>(&stripeWidth)->default_value(1), "Width of each stripe of the stripes initial condition.")
+        ("domain-size", boost::program_options::value<long long>(&domainSize)->default_value(16), "Side of each square domain of the domains initial condition.")
+        ("init-file", boost::program_options::value<std::string>(&initialLatticeName), "Row major file of one byte per cell loaded by the file initial condition, whatever the layout.")
+        ("threads,t", boost::program_options::value<int>(&threadCount)->default_value(0), "Number of threads used to initialise the lattice, 0 uses every hardware thread.")
+        ("affinity", boost::program_options::value<std::string>(&affinity)->default_value("none"), "Pin worker threads: none, compact (fill one NUMA node first), scatter (spread over the nodes) or a cpu list such as 0-7,16-23. The main thread is pinned as the first worker, and a single simulation that is not --synchronous is swept by it alone, so only the cpus on its node are used.")
+        ("frame-interval", boost::program_options::value<int>(&frameInterval)->default_value(0), "Write a PPM image of the 2D lattice every this many sweeps, 0 writes none.")
+        ("frame-block", boost::program_options::value<long long>(&frameBlock)->default_value(0), "Side of the block of cells averaged into each image pixel, 0 picks it from --frame-size.")
+        ("frame-size", boost::program_options::value<long long>(&frameSize)->default_value(1024), "Largest image side used to pick the block size automatically.")
+        ("shared-memory", boost::program_options::value<std::string>(&sharedMemoryName), "Publish the 2D lattice in this POSIX shared memory region, e.g. /consensus, for consensus_view to read.")
+        ("view-interval", boost::program_options::value<int>(&viewInterval)->default_value(1), "Publish the lattice to shared memory every this many sweeps.")
+        ("measure-threads", boost::program_options::value<int>(&measureThreads)->default_value(1), "Number of threads measuring snapshots of the 2D lattice while the sweeps continue.")
+        ("clusters", "Measure the number of clusters and the largest cluster of the 2D lattice into Clusters.dat.")
+        ("interface-log", "Write the density of unlike nearest neighbour bonds of the 2D lattice, and of each unlike pair, into Interface.dat every sweep.")
+        ("stop-density", boost::program_options::value<double>(&stopDensity)->default_value(-1), "Stop the 2D lattice once the density of unlike bonds falls to this value, a negative value never stops.")
+        ("correlation", boost::program_options::value<long long>(&correlationDistance)->default_value(0), "Measure the equal-state correlation function of the 2D lattice up to this distance into Correlation.dat.")
+        ("scan-p2", boost::program_options::value<std::vector<double>>(&scanP2)->multitoken(), "Run a continuation through these values of p_2, carrying the state over between them, instead of a single simulation.")
+        ("scan-p1", boost::program_options::value<std::vector<double>>(&scanP1)->multitoken(), "Values of p_1 for each point of the continuation, defaults to p_1 at every point.")
+        ("hysteresis", "Run the continuation back through the same points after reaching the last one.")
+        ("equilibration", boost::program_options::value<int>(&equilibrationSweeps)->default_value(1000), "Sweeps run at each point of the continuation before measuring.")
+        ("measurement-sweeps", boost::program_options::value<int>(&measurementSweeps)->default_value(1000), "Sweeps measured at each point of the continuation.")
+        ("prefetch-distance", boost::program_options::value<int>(&prefetchDistance)->default_value(ConsensusArray::defaultPrefetchDistance), "Updates of a row major 2D lattice drawn ahead so their cells can be prefetched, 0 turns this off. The results do not depend on it.")
+        ("profile", "Read hardware counters (cycles, instructions, LLC misses, branch misses) around the sweep, measurement and output phases and report them per site update with the results.")
+        ("synchronous", "Update every site of the 2D lattice at once from the previous sweep, a cellular automaton, instead of one random site at a time.")
+        ("zealots", boost::program_options::value<double>(&zealotFraction)->default_value(0), "Fraction of sites of the 2D lattice that are zealots, which are never invaded.")
+        ("class-rates", boost::program_options::value<std::vector<double>>(&classRates)->multitoken(), "p_1 p_2 pairs of rate classes 1, 2, ... for quenched disorder, sites are invaded at their own class's rates.")
+        ("class-fractions", boost::program_options::value<std::vector<double>>(&classFractions)->multitoken(), "Fraction of sites put at random into each of rate classes 1, 2, ..., the rest are in class 0 at p_1, p_2.")
+        ("site-file", boost::program_options::value<std::string>(&siteFileName), "File of one byte per site in storage order giving each site's rate class, plus 128 for a zealot, mapped instead of random classes.")
+        ("ensemble", "Estimate the probability of consensus within --sweeps, and the consensus time distribution, from adaptively sampled replicas at p_1, p_2 or at each point of --scan-p2.")
+        ("target-error", boost::program_options::value<double>(&targetError)->default_value(0.05), "Half width of the 95% confidence interval at which the ensemble stops sampling a point.")
+        ("max-replicas", boost::program_options::value<long long>(&maxReplicas)->default_value(1000), "Most replicas the ensemble runs at a point.")
+        ("batch", boost::program_options::value<int>(&batchSize)->default_value(0), "Replicas the ensemble runs between updates of its estimates, 0 uses four per thread.")
+        ("histogram-bins", boost::program_options::value<int>(&histogramBins)->default_value(20), "Number of bins in the consensus time histograms of the ensemble.")
+        ("splitting", "Estimate a small probability of consensus within --sweeps by multilevel splitting on the majority fraction of the 2D lattice.")
+        ("levels", boost::program_options::value<std::vector<double>>(&splittingLevels)->multitoken(), "Increasing majority fractions the splitting climbs through, defaults to --level-count even levels from 0.4 to 1.")
+        ("level-count", boost::program_options::value<int>(&levelCount)->default_value(12), "Number of even splitting levels used when --levels is not given.")
+        ("trials", boost::program_options::value<long long>(&trialCount)->default_value(1000), "Trials the splitting runs at each level.")
+        ("repetitions", boost::program_options::value<int>(&repetitionCount)->default_value(4), "Independent repetitions of the splitting, whose spread gives the error bar.")
+        ("slice", boost::program_options::value<long long>(&slicePosition)->default_value(0), "Position along the higher dimensions of the slice printed when animating a lattice that is not 2D.")
         ("help,h", "Produce help message");
 
     // Make arguments available to program.
@@ -67,26 +187,497 @@ int main(int argc, char const *argv[])
         return 1;
     }
 
+    // Use every hardware thread unless told otherwise.
+    if(threadCount <= 0)
+    {
+      threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    viewInterval = std::max(1, viewInterval);
+
+    // A scan takes one p_1 for every point or one for all of them, and needs two measurements at each point for an error.
+    if(scanP1.size() > 1 && scanP1.size() != std::max<std::size_t>(1, scanP2.size()))
+    {
+      std::cerr << "--scan-p1 needs one value, or one for every value of --scan-p2.\n";
+      return 1;
+    }
+    measurementInterval = std::max(1, measurementInterval);
+    if(!scanP2.empty() && !vm.count("ensemble") && measurementSweeps <= measurementInterval)
+    {
+      std::cerr << "A continuation needs at least two measurements at each point: make --measurement-sweeps larger than --measurement-interval.\n";
+      return 1;
+    }
+
+    // Any other layout name would silently run row major.
+    if("rowmajor" != layoutName && "tiled" != layoutName)
+    {
+      std::cerr << "Unknown layout: " << layoutName << '\n';
+      return 1;
+    }
+    if("tiled" == layoutName && (tileSize < 1 || 0 != (tileSize & (tileSize - 1)) || 0 != rowCount % tileSize || 0 != colCount % tileSize))
+    {
+      std::cerr << "The tile size must be a power of two that divides the number of rows and columns.\n";
+      return 1;
+    }
+
+    // Pin workers before anything is allocated, so the lattice is first touched on the nodes that will use it.
+    // The main thread runs as worker 0, so its generator and the buffers it fills stay on that worker's node.
+    try
+    {
+      ThreadAffinity::setPolicy(affinity);
+    }
+    catch(const std::invalid_argument &error)
+    {
+      std::cerr << error.what() << '\n';
+      return 1;
+    }
+    ThreadAffinity::pinWorker(0);
+
     // Create an output directory from either the default time stamp or the user defined string.
     makeDirectory(outputName);
 
+    // Splitting estimates probabilities too small for the ensemble to sample directly, by cloning the
+    // lattices that get closest to consensus.
+    if(vm.count("splitting"))
+    {
+      ConsensusArray::Layout layout = ("tiled" == layoutName) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+      if(splittingLevels.empty())
+      {
+        splittingLevels = SplittingSampler::evenLevels(0.4, levelCount);
+      }
+
+      std::uint64_t splittingSeed = (static_cast<std::uint64_t>(generator()) << 32) ^ generator();
+      SplittingSampler sampler(rowCount, colCount, p_1, p_2, layout, tileSize, splittingLevels, trialCount, totalSweeps, threadCount, splittingSeed);
+      sampler.run(repetitionCount, std::cout);
+
+      std::fstream splittingOutput(outputName+"/Splitting.dat", std::ios::out);
+      sampler.writeSummary(splittingOutput);
+
+      std::cout << "Probability of consensus within " << totalSweeps << " sweeps = " << sampler.probability() << " +- " << sampler.error() << '\n';
+      std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time take to execute(s) =    " <<
+      std::right << timer.elapsed() << '\n';
+      return 0;
+    }
+
+    // An ensemble runs many independent replicas in parallel instead of a single simulation, of the
+    // mean-field model or of a randomly initialised 2D lattice.
+    if(vm.count("ensemble"))
+    {
+      EnsembleDriver::ModelFactory factory;
+      if(vm.count("mean-field"))
+      {
+        long long size = population > 0 ? population : rowCount * colCount;
+        MeanFieldConsensus::Method method = tau > 0 ? MeanFieldConsensus::TauLeaping : MeanFieldConsensus::Gillespie;
+        factory = [size, method, tau](std::default_random_engine &replicaGenerator, double p1, double p2) {
+          return std::unique_ptr<ConsensusModel>(new MeanFieldConsensus(replicaGenerator, size, p1, p2, method, tau));
+        };
+      }
+      else
+      {
+        ConsensusArray::Layout layout = ("tiled" == layoutName) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+        bool synchronous = vm.count("synchronous") > 0;
+        factory = [rowCount, colCount, layout, tileSize, synchronous](std::default_random_engine &replicaGenerator, double p1, double p2) {
+          // Replicas already run in parallel, so a synchronous replica sweeps on one thread.
+          ConsensusArray *lattice = synchronous ? new SynchronousConsensusArray(LatticeStorage(rowCount * colCount), rowCount, colCount, p1, p2, 1)
+                                                : new ConsensusArray(LatticeStorage(rowCount * colCount), rowCount, colCount, p1, p2, layout, tileSize);
+          LatticeInitialiser(replicaGenerator, 1).random(*lattice);
+          return std::unique_ptr<ConsensusModel>(lattice);
+        };
+      }
+
+      if(scanP2.empty())
+      {
+        scanP2.push_back(p_2);
+      }
+      if(scanP1.empty())
+      {
+        scanP1.push_back(p_1);
+      }
+      if(1 == scanP1.size())
+      {
+        scanP1.resize(scanP2.size(), scanP1[0]);
+      }
+
+      EnsembleDriver ensemble(factory, totalSweeps, measurementInterval, targetError, maxReplicas, threadCount, batchSize, generator());
+      ensemble.run(scanP1, scanP2, std::cout);
+
+      std::fstream ensembleOutput(outputName+"/Ensemble.dat", std::ios::out);
+      ensemble.writeSummary(ensembleOutput);
+      std::fstream histogramOutput(outputName+"/ConsensusTimes.dat", std::ios::out);
+      ensemble.writeHistograms(histogramOutput, histogramBins);
+
+      std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time take to execute(s) =    " <<
+      std::right << timer.elapsed() << '\n';
+      return 0;
+    }
+
     // Create an output file for the lattice so it can be animated.
     std::fstream latticeOutput(outputName+"/Lattice.dat", std::ios::out);
 
     // Create an output file for the order parameter which in this case is the fraction of infected states.
     std::fstream fractionsOutput(outputName+"/Fractions.dat", std::ios::out);
 
+    // Create output files for the optional observables of a 2D lattice.
+    std::fstream clustersOutput;
+    std::fstream correlationOutput;
+    std::fstream interfaceOutput;
+
     // Create an output file for the input parameters.
     std::fstream inputParametersOutput(outputName+"/Input.txt", std::ios::out);
 
     // Create an output file for the results.
     std::fstream resultsOutput(outputName+"/Results.txt", std::ios::out);
 
-    // Create a Consensus lattice that will be used in the simulation.
-    ConsensusArray lattice(generator,rowCount, colCount, p_1, p_2);
+    // Only a synchronous lattice is swept by several threads. Every other engine is swept by the main thread
+    // alone, so its memory is filled by workers on the main thread's node rather than spread over the nodes.
+    if(!vm.count("synchronous"))
+    {
+      ThreadAffinity::restrictToNode(0);
+    }
+
+    // The profiler has to exist before any worker thread so that the workers' counts are included.
+    std::unique_ptr<PhaseProfiler> profiler;
+    if(vm.count("profile"))
+    {
+      profiler.reset(new PhaseProfiler());
+    }
+    auto enterPhase = [&profiler](PhaseProfiler::Phase phase) {
+      if(profiler)
+      {
+        profiler->enter(phase);
+      }
+    };
+
+    // Create the model that will be used in the simulation. Lattice engines also provide a way
+    // to print the lattice, or a 2D slice of it, for animation and may write a binary dump at the end.
+    std::unique_ptr<ConsensusModel> model;
+    std::function<void(std::ostream&)> printLattice;
+    std::function<void(std::ostream&)> writeBinaryLattice;
+    ConsensusArray *planarLattice = nullptr;
+    std::string engine;
+
+    if(vm.count("mean-field"))
+    {
+      if(0 == population)
+      {
+        population = static_cast<long long>(rowCount) * colCount;
+      }
+
+      MeanFieldConsensus::Method method = tau > 0 ? MeanFieldConsensus::TauLeaping : MeanFieldConsensus::Gillespie;
+      model.reset(new MeanFieldConsensus(generator, population, p_1, p_2, method, tau));
+      engine = tau > 0 ? "mean-field(tau-leaping)" : "mean-field(gillespie)";
+    }
+    else if(vm.count("graph"))
+    {
+      if(0 == population)
+      {
+        population = static_cast<long long>(rowCount) * colCount;
+      }
+
+      ConsensusGraph::Vertex vertexCount = static_cast<ConsensusGraph::Vertex>(population);
+      bool reorderVertices = !vm.count("no-reorder");
+
+      if("file" == graphType && edgeListName.empty())
+      {
+        std::cerr << "--graph file needs an --edge-list.\n";
+        return 1;
+      }
+
+      // An edge list that cannot be read, or a regular graph with an odd number of edge ends, cannot be built.
+      try
+      {
+        if("file" == graphType)
+        {
+          model.reset(new ConsensusGraph(generator, edgeListName, p_1, p_2, reorderVertices));
+        }
+        else
+        {
+          std::vector<ConsensusGraph::Edge> edges;
+          if("square" == graphType)
+          {
+            vertexCount = static_cast<ConsensusGraph::Vertex>(rowCount) * colCount;
+            edges = ConsensusGraph::squareLatticeEdges(static_cast<ConsensusGraph::Vertex>(rowCount), static_cast<ConsensusGraph::Vertex>(colCount));
+          }
+          else if("regular" == graphType)
+          {
+            edges = ConsensusGraph::randomRegularEdges(vertexCount, degree, generator);
+          }
+          else if("small-world" == graphType)
+          {
+            edges = ConsensusGraph::smallWorldEdges(vertexCount, degree, rewireProbability, generator);
+          }
+          else
+          {
+            std::cerr << "Unknown network type: " << graphType << '\n';
+            return 1;
+          }
+
+          model.reset(new ConsensusGraph(generator, vertexCount, edges, p_1, p_2, reorderVertices));
+        }
+      }
+      catch(const std::exception &error)
+      {
+        std::cerr << error.what() << '\n';
+        return 1;
+      }
+      engine = "graph(" + graphType + ")";
+    }
+    else if(2 != dimension)
+    {
+      if(0 == length)
+      {
+        length = rowCount;
+      }
+
+      // The printed slice fixes every coordinate past the first two, so it must lie inside the lattice.
+      if(length < 1 || slicePosition < 0 || slicePosition >= length)
+      {
+        std::cerr << "The slice must lie in [0, " << length << ") and the lattice needs a length of at least 1.\n";
+        return 1;
+      }
+
+      switch (dimension) {
+        case 1:
+        {
+          auto hypercubic = new HypercubicLattice<1>(generator, length, p_1, p_2);
+          model.reset(hypercubic);
+          printLattice = [hypercubic](std::ostream &out) { out << *hypercubic; };
+          writeBinaryLattice = [hypercubic](std::ostream &out) { hypercubic->writeBinary(out); };
+          break;
+        }
+
+        case 3:
+        {
+          auto hypercubic = new HypercubicLattice<3>(generator, length, p_1, p_2);
+          model.reset(hypercubic);
+          printLattice = [hypercubic, slicePosition](std::ostream &out) { hypercubic->writeSlice(out, slicePosition); };
+          writeBinaryLattice = [hypercubic](std::ostream &out) { hypercubic->writeBinary(out); };
+          break;
+        }
+
+        case 4:
+        {
+          auto hypercubic = new HypercubicLattice<4>(generator, length, p_1, p_2);
+          model.reset(hypercubic);
+          printLattice = [hypercubic, slicePosition](std::ostream &out) { hypercubic->writeSlice(out, slicePosition); };
+          writeBinaryLattice = [hypercubic](std::ostream &out) { hypercubic->writeBinary(out); };
+          break;
+        }
+
+        default:
+          std::cerr << "Unsupported lattice dimension: " << dimension << '\n';
+          return 1;
+      }
+      engine = "hypercubic(d=" + std::to_string(dimension) + ",L=" + std::to_string(length) + ")";
+    }
+    else
+    {
+      ConsensusArray::Layout layout = ("tiled" == layoutName) ? ConsensusArray::Tiled : ConsensusArray::RowMajor;
+      // Carrying on needs the file of an earlier run of the same size, which must not be overwritten.
+      if("keep" == initialCondition && (!vm.count("mmap-file") || !boost::filesystem::exists(mappedLatticeName) ||
+         boost::filesystem::file_size(mappedLatticeName) != static_cast<std::uintmax_t>(rowCount * colCount)))
+      {
+        std::cerr << "The keep initial condition needs an existing --mmap-file of one byte for each of the rows*columns cells.\n";
+        return 1;
+      }
+      if("file" == initialCondition && initialLatticeName.empty())
+      {
+        std::cerr << "The file initial condition needs an --init-file.\n";
+        return 1;
+      }
+      if("file" == initialCondition && vm.count("mmap-file") && boost::filesystem::exists(initialLatticeName) &&
+         boost::filesystem::exists(mappedLatticeName) && boost::filesystem::equivalent(initialLatticeName, mappedLatticeName))
+      {
+        std::cerr << "To carry on from --mmap-file use --init keep, loading it as --init-file would read the cells while writing them.\n";
+        return 1;
+      }
+      if(rowCount < 1 || colCount < 1)
+      {
+        std::cerr << "The lattice needs at least one row and column.\n";
+        return 1;
+      }
+
+      LatticeStorage storage = vm.count("mmap-file") ? LatticeStorage(mappedLatticeName, rowCount * colCount) : LatticeStorage(rowCount * colCount);
+      ConsensusArray *lattice;
+
+      // A synchronous lattice double buffers its cells, so it has to own them.
+      if(vm.count("synchronous"))
+      {
+        if(zealotFraction > 0 || !classRates.empty() || !classFractions.empty() || vm.count("site-file") || vm.count("mmap-file") || "tiled" == layoutName)
+        {
+          std::cerr << "Synchronous updates need a row major lattice in memory without disorder.\n";
+          return 1;
+        }
+        lattice = new SynchronousConsensusArray(std::move(storage), rowCount, colCount, p_1, p_2, threadCount);
+      }
+      // Only lattices with disorder pay for looking up site attributes.
+      else if(zealotFraction > 0 || !classRates.empty() || !classFractions.empty() || vm.count("site-file"))
+      {
+        if(classRates.size() % 2 != 0)
+        {
+          std::cerr << "Rate classes need p_1 p_2 pairs.\n";
+          return 1;
+        }
+        // A class without rates of its own, or with rates that are not probabilities, would quietly run at class 0's.
+        if(classFractions.size() > classRates.size() / 2)
+        {
+          std::cerr << "--class-fractions puts sites in " << classFractions.size() << " classes but --class-rates only gives rates for "
+                    << classRates.size() / 2 << ".\n";
+          return 1;
+        }
+        if(std::any_of(classRates.begin(), classRates.end(), [](double rate) { return !(rate >= 0 && rate <= 1); }))
+        {
+          std::cerr << "Class rates must lie in [0, 1].\n";
+          return 1;
+        }
+
+        // Too many classes, or a site file that is missing or the wrong size, fails here.
+        std::unique_ptr<DisorderedConsensusArray> disordered(new DisorderedConsensusArray(std::move(storage), rowCount, colCount, p_1, p_2, layout, tileSize));
+        try
+        {
+          for(std::size_t rateClass = 0; rateClass < classRates.size() / 2; ++rateClass)
+          {
+            disordered->setClassRates(static_cast<int>(rateClass) + 1, classRates[2 * rateClass], classRates[2 * rateClass + 1]);
+          }
+
+          if(vm.count("site-file"))
+          {
+            disordered->loadSites(siteFileName);
+          }
+          else
+          {
+            disordered->randomiseSites(generator, classFractions, zealotFraction, threadCount);
+          }
+        }
+        catch(const std::exception &error)
+        {
+          std::cerr << error.what() << '\n';
+          return 1;
+        }
+        lattice = disordered.release();
+      }
+      else
+      {
+        lattice = new ConsensusArray(std::move(storage), rowCount, colCount, p_1, p_2, layout, tileSize);
+      }
+      lattice->setPrefetchDistance(prefetchDistance);
+      model.reset(lattice);
+      planarLattice = lattice;
+
+      // The cells are not initialised yet, fill them in parallel with the requested initial condition.
+      LatticeInitialiser initialiser(generator, threadCount);
+
+      // A file that cannot be loaded, or a stripe or domain size below one cell, fails here.
+      try
+      {
+        if("random" == initialCondition)
+        {
+          initialiser.random(*lattice);
+        }
+        else if("biased" == initialCondition)
+        {
+          if(initialFractions.size() != ConsensusModel::MAXSTATE)
+          {
+            std::cerr << "A biased initial condition needs three fractions.\n";
+            return 1;
+          }
+          initialiser.random(*lattice, initialFractions.data());
+        }
+        else if("stripes" == initialCondition)
+        {
+          initialiser.stripes(*lattice, stripeWidth);
+        }
+        else if("domains" == initialCondition)
+        {
+          initialiser.domains(*lattice, domainSize);
+        }
+        else if("file" == initialCondition)
+        {
+          initialiser.load(*lattice, initialLatticeName);
+        }
+        else if("keep" == initialCondition)
+        {
+          initialiser.keep(*lattice);
+        }
+        else
+        {
+          std::cerr << "Unknown initial condition: " << initialCondition << '\n';
+          return 1;
+        }
+      }
+      catch(const std::exception &error)
+      {
+        std::cerr << error.what() << '\n';
+        return 1;
+      }
+
+      // A lattice too big for RAM is far too big to print as text.
+      if(!vm.count("mmap-file"))
+      {
+        printLattice = [lattice](std::ostream &out) { out << *lattice; };
+      }
+      engine = std::string(dynamic_cast<DisorderedConsensusArray*>(lattice) ? "disordered-lattice(" : dynamic_cast<SynchronousConsensusArray*>(lattice) ? "synchronous-lattice(" : "lattice(") + layoutName + ")";
+    }
+
+    // Images of a 2D lattice are rendered on a background thread into their own directory.
+    std::unique_ptr<FrameRenderer> frameRenderer;
+    if(frameInterval > 0 && planarLattice)
+    {
+      if(0 == frameBlock)
+      {
+        frameBlock = (std::max(rowCount, colCount) + frameSize - 1) / frameSize;
+      }
+
+      boost::filesystem::create_directories(outputName+"/frames");
+      frameRenderer.reset(new FrameRenderer(outputName+"/frames", frameBlock, threadCount));
+    }
+
+    // A live view of a 2D lattice is published in shared memory for other processes to snapshot.
+    std::unique_ptr<SharedLatticeView> sharedView;
+    if(vm.count("shared-memory") && planarLattice)
+    {
+      try
+      {
+        sharedView.reset(new SharedLatticeView(sharedMemoryName, *planarLattice));
+      }
+      catch(const std::runtime_error &error)
+      {
+        std::cerr << error.what() << '\n';
+        return 1;
+      }
+      sharedView->publish(*planarLattice, 0);
+    }
+
+    // The fractions of a 2D lattice are read from its counts in place. Observables that read the cells
+    // are measured on snapshots by worker threads while the sweeps continue, or in place for a mapped lattice.
+    std::unique_ptr<MeasurementExecutor> measurementExecutor;
+    if(planarLattice)
+    {
+      measurementExecutor.reset(new MeasurementExecutor(measureThreads));
+      measurementExecutor->add(std::unique_ptr<MeasurementExecutor::IObservable>(new FractionObservable()), fractionsOutput);
+
+      if(vm.count("clusters"))
+      {
+        clustersOutput.open(outputName+"/Clusters.dat", std::ios::out);
+        measurementExecutor->add(std::unique_ptr<MeasurementExecutor::IObservable>(new ClusterObservable()), clustersOutput);
+      }
+      if(correlationDistance > 0)
+      {
+        correlationOutput.open(outputName+"/Correlation.dat", std::ios::out);
+        measurementExecutor->add(std::unique_ptr<MeasurementExecutor::IObservable>(new CorrelationObservable(correlationDistance)), correlationOutput);
+      }
+    }
+
+    // The interface density is tracked by the 2D lattice, so it is cheap enough to log every sweep.
+    if(vm.count("interface-log") && planarLattice)
+    {
+      interfaceOutput.open(outputName+"/Interface.dat", std::ios::out);
+    }
 
     // Print the initial lattice to an output file.
-    latticeOutput << lattice;
+    if(printLattice)
+    {
+      printLattice(latticeOutput);
+    }
 
     // Create an object to hold the input parameters.
     ConsensusInputParameters inputParameters
@@ -96,7 +687,9 @@ int main(int argc, char const *argv[])
       p_1,
       p_2,
       totalSweeps,
-      outputName
+      outputName,
+      engine,
+      model->getSize()
     };
 
     // Print the input parameters to the command line and to the output file.
@@ -107,35 +700,100 @@ int main(int argc, char const *argv[])
 ************************************************* Main Loop *************************************************************
 *************************************************************************************************************************/
 
+   // Sweeps run, for reporting the profile per site update.
+   long long sweepsRun = 0;
+
+   // A continuation scan takes the place of the main loop, writing one line per point to its summary table.
+   if(!scanP2.empty())
+   {
+     if(scanP1.empty())
+     {
+       scanP1.push_back(p_1);
+     }
+
+     std::fstream continuationOutput(outputName+"/Continuation.dat", std::ios::out);
+     Continuation continuation(equilibrationSweeps, measurementSweeps, measurementInterval);
+     std::vector<Continuation::Point> points = Continuation::points(scanP1, scanP2, vm.count("hysteresis") > 0);
+     enterPhase(PhaseProfiler::Sweep);
+     continuation.run(*model, generator, points, continuationOutput);
+     sweepsRun = static_cast<long long>(points.size()) * (equilibrationSweeps + measurementSweeps);
+     totalSweeps = 0;
+   }
 
    for(int sweep = 0; sweep < totalSweeps; ++sweep )
    {
-      // Update the lattice by performing row*col sweeps.
-      for(int i = 0; i < lattice.getSize(); ++i)
+      // Update the model by performing a sweep. Phases are only switched around work that happens,
+      // so sweeps with nothing else to do never read the counters.
+      enterPhase(PhaseProfiler::Sweep);
+      model->sweep(generator);
+      ++sweepsRun;
+
+      bool measuring = (0 == sweep%measurementInterval);
+      if(measuring || interfaceOutput.is_open())
       {
-        lattice.update(generator);
+        enterPhase(PhaseProfiler::Measurement);
       }
 
       // If we are on a measurement sweep then do any measurement/output.
-      if((0 == sweep%10))
+      if(measuring && measurementExecutor)
+      {
+        measurementExecutor->submit(*planarLattice, sweep);
+      }
+      else if(measuring)
       {
         // Calculate the fraction of each type.
-        double redFrac = lattice.stateFraction(ConsensusArray::Red);
-        double greenFrac = lattice.stateFraction(ConsensusArray::Green);
-        double blueFrac = lattice.stateFraction(ConsensusArray::Blue);
+        double redFrac = model->stateFraction(ConsensusModel::Red);
+        double greenFrac = model->stateFraction(ConsensusModel::Green);
+        double blueFrac = model->stateFraction(ConsensusModel::Blue);
 
         // Output the fraction of infected states and the current sweep.
         fractionsOutput << sweep << ' ' <<  redFrac << ' ' << greenFrac << ' ' << blueFrac << '\n';
 
 
       }
-      if(vm.count("animate"))
+
+      if(interfaceOutput.is_open())
+      {
+        // Each unlike pair is given as a fraction of all bonds, so the three sum to the interface density.
+        double bonds = static_cast<double>(std::max(1LL, planarLattice->totalBondCount()));
+        interfaceOutput << sweep << ' ' << planarLattice->interfaceDensity() << ' '
+                        << planarLattice->bondCount(ConsensusModel::Red, ConsensusModel::Green) / bonds << ' '
+                        << planarLattice->bondCount(ConsensusModel::Red, ConsensusModel::Blue) / bonds << ' '
+                        << planarLattice->bondCount(ConsensusModel::Green, ConsensusModel::Blue) / bonds << '\n';
+      }
+
+      bool rendering = frameRenderer && 0 == sweep%frameInterval;
+      bool publishing = sharedView && 0 == sweep%viewInterval;
+      bool animating = vm.count("animate") && printLattice;
+      if(rendering || publishing || animating)
+      {
+        enterPhase(PhaseProfiler::Output);
+      }
+
+      if(rendering)
+      {
+        frameRenderer->submit(*planarLattice, sweep);
+      }
+      if(publishing)
+      {
+        sharedView->publish(*planarLattice, sweep);
+      }
+
+      if(animating)
       {
         // Move to the top of the file.
       latticeOutput.seekg(0,std::ios::beg);
 
       // Output the current state of the lattice.
-      latticeOutput << lattice << std::flush;
+      printLattice(latticeOutput);
+      latticeOutput << std::flush;
+      }
+
+      // Stop coarsening once the interfaces have thinned out enough.
+      if(planarLattice && planarLattice->interfaceDensity() <= stopDensity)
+      {
+        std::cout << "Interface density reached " << planarLattice->interfaceDensity() << " after sweep " << sweep << '\n';
+        break;
       }
    }
 
@@ -144,22 +802,44 @@ int main(int argc, char const *argv[])
 ******************************************** Output/Clean Up *************************************************************
 **************************************************************************************************************************/
 
+   // Wait for any frames still being rendered and measurements still being made. The workers count
+   // their own work, the main thread's wait is booked to the phase it waits for.
+   enterPhase(PhaseProfiler::Output);
+   frameRenderer.reset();
+   enterPhase(PhaseProfiler::Measurement);
+   measurementExecutor.reset();
+   enterPhase(PhaseProfiler::Output);
+
    // At the end of the simulation check to see whether the simulation has reached an abosorbing state.
-   bool hasReachedAbsorbingState = (lattice.stateCount(ConsensusArray::Red) == rowCount*colCount)
-     || (lattice.stateCount(ConsensusArray::Green) == rowCount*colCount)
-     || (lattice.stateCount(ConsensusArray::Blue) == rowCount*colCount);
+   bool hasReachedAbsorbingState = model->isAbsorbed();
 
      ConsensusResults results
      {
        hasReachedAbsorbingState
      };
 
+     // Lattices that are too big to print as text are dumped as one byte per site.
+     if(writeBinaryLattice)
+     {
+       std::fstream binaryOutput(outputName+"/Lattice.bin", std::ios::out | std::ios::binary);
+       writeBinaryLattice(binaryOutput);
+     }
+
      // Output results to file.
    	resultsOutput << results << '\n';
 
     // Output results to command line.
     std::cout << results << '\n';
 
+    // Every site is updated once per sweep on average.
+    if(profiler)
+    {
+      profiler->enter(PhaseProfiler::Output);
+      double siteUpdates = static_cast<double>(sweepsRun) * model->getSize();
+      profiler->writeReport(resultsOutput, siteUpdates);
+      profiler->writeReport(std::cout, siteUpdates);
+    }
+
    // Report how long the program took to execute.
    std::cout << std::setw(30) << std::setfill(' ') << std::left << "Time take to execute(s) =    " <<
    std::right << timer.elapsed() << '\n';
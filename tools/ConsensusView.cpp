@@ -0,0 +1,112 @@
+#include "SharedLatticeView.hpp"
+#include "ConsensusArray.hpp"
+#include <boost/program_options.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <chrono>
+
+/**
+ *\file
+ *\brief Viewer that takes snapshots of a lattice published by consensus --shared-memory.
+ *
+ * Each new snapshot is printed as a line of species fractions and, if asked, written to a lattice
+ * file in the same format as Lattice.dat. The file is written under a temporary name and renamed
+ * into place so that gnuplot never reads a half written frame.
+ */
+int main(int argc, char const *argv[])
+{
+    std::string sharedMemoryName;
+    std::string latticeName;
+    double interval;
+
+    boost::program_options::options_description desc("Options for Consensus viewer");
+
+    desc.add_options()
+
+        ("shared-memory", boost::program_options::value<std::string>(&sharedMemoryName)->default_value("/consensus"), "Name of the shared memory region the simulation publishes to.")
+        ("output,o", boost::program_options::value<std::string>(&latticeName), "Write each new snapshot to this lattice file, e.g. Lattice.dat for gnuplot.")
+        ("interval,i", boost::program_options::value<double>(&interval)->default_value(0.5), "Seconds between snapshots.")
+        ("once", "Take a single snapshot and exit.")
+        ("help,h", "Produce help message");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc,argv,desc), vm);
+    boost::program_options::notify(vm);
+
+    if(vm.count("help"))
+    {
+        std::cout << desc << '\n';
+        return 1;
+    }
+
+    // The simulation may not have published yet, or the name may be wrong.
+    std::unique_ptr<SharedLatticeView> view;
+    try
+    {
+        view.reset(new SharedLatticeView(sharedMemoryName));
+    }
+    catch(const std::runtime_error &error)
+    {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    SharedLatticeView::Snapshot snapshot;
+    std::uint64_t lastGeneration = 0;
+
+    // The region is removed when the simulation exits, which is when the viewer stops too.
+    while(true)
+    {
+        std::uint64_t generation = view->snapshot(snapshot);
+        if(generation != lastGeneration)
+        {
+            lastGeneration = generation;
+            double size = static_cast<double>(snapshot.rows * snapshot.cols);
+            std::cout << std::setw(10) << snapshot.sweep
+                      << ' ' << snapshot.counts[ConsensusModel::Red] / size
+                      << ' ' << snapshot.counts[ConsensusModel::Green] / size
+                      << ' ' << snapshot.counts[ConsensusModel::Blue] / size << std::endl;
+
+            if(vm.count("output"))
+            {
+                std::string temporaryName = latticeName + ".tmp";
+                {
+                    std::ofstream latticeOutput(temporaryName);
+                    for(long long row = 0; row < snapshot.rows; ++row)
+                    {
+                        for(long long col = 0; col < snapshot.cols; ++col)
+                        {
+                            latticeOutput << ConsensusArray::stateSymbols[snapshot.cells[row * snapshot.cols + col]] << ' ';
+                        }
+                        latticeOutput << '\n';
+                    }
+                }
+                std::rename(temporaryName.c_str(), latticeName.c_str());
+            }
+        }
+
+        if(vm.count("once"))
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+
+        // Stop once the simulation has finished and removed its region.
+        try
+        {
+            SharedLatticeView probe(sharedMemoryName);
+        }
+        catch(const std::runtime_error&)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
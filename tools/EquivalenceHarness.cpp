@@ -0,0 +1,697 @@
+#include "ConsensusArray.hpp"
+#include "DisorderedConsensusArray.hpp"
+#include "ConsensusGraph.hpp"
+#include "HypercubicLattice.hpp"
+#include "LatticeInitialiser.hpp"
+#include "CounterRandom.hpp"
+#include "ParallelFor.hpp"
+#include "Timer.hpp"
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef CONSENSUS_MPI
+#include "DistributedConsensusArray.hpp"
+#include <mpi.h>
+#endif
+
+/**
+ *\file
+ *\brief Harness that checks alternative engines simulate the same process as the reference ConsensusArray.
+ *
+ * For every lattice side and (p_1, p_2) on a grid, independent replicas of the reference engine
+ * (a row major ConsensusArray) and of each candidate are started from random lattices and run the
+ * same way as the main loop. For each replica the red fraction and the density of unlike
+ * neighbour pairs are recorded at fixed sweeps, as is the sweep at which consensus is reached.
+ * The fixed time distributions are compared with two-sample Kolmogorov-Smirnov tests and the
+ * consensus times, binned with a bin for replicas that never reach consensus, with a two-sample
+ * chi-squared test. With a Bonferroni correction over every test the harness passes if no p-value
+ * falls below alpha divided by the number of tests, and exits with 0 on a pass and 1 on a fail.
+ *
+ * --perturb runs the candidates at p_2 + perturbation, which should fail, to check the tests
+ * have the power to see a real difference at the chosen number of replicas.
+ *
+ * The pipelined row major sweep claims more than equivalence: it draws the same numbers in the
+ * same order as the plain sweep, so the trajectory is identical. At every grid point a few row
+ * major replicas are therefore run twice from the same seed, with --prefetch and with prefetching
+ * off, and fail unless the lattices and generators agree after every sweep.
+ *
+ * Built with CONSENSUS_MPI (make equivalence_mpi) and run under mpirun, the harness also offers
+ * the candidate "mpi": a DistributedConsensusArray split over every rank. Its replicas are run one
+ * after another by all ranks together, each rank with its own stream, and rank 0 then runs the
+ * other engines and reports. Every side must give each rank at least four rows.
+ */
+namespace
+{
+    /// The observables of one replica.
+    struct Sample
+    {
+        /// Red fraction at each fixed time.
+        std::vector<double> redFractions;
+        /// Density of unlike neighbour pairs at each fixed time.
+        std::vector<double> interfaceDensities;
+        /// Sweep at which consensus was reached, or -1.
+        int consensusTime;
+    };
+
+    /// An engine under test.
+    struct Engine
+    {
+        /// Name used on the command line and in the report.
+        std::string name;
+        /// Creates a randomly initialised side x side lattice.
+        std::function<std::unique_ptr<ConsensusModel>(std::default_random_engine&, long long, double, double)> create;
+        /// Returns the density of unlike neighbour pairs of a side x side lattice.
+        std::function<double(ConsensusModel&, long long)> interfaceDensity;
+        /// True if every MPI rank must take part in each replica.
+        bool collective;
+    };
+
+    /// Fraction of right and down neighbour pairs on the periodic lattice holding different states.
+    double interfaceDensity(const std::vector<ConsensusModel::State> &cells, long long side)
+    {
+        long long unlike = 0;
+        for(long long row = 0; row < side; ++row)
+        {
+            for(long long col = 0; col < side; ++col)
+            {
+                ConsensusModel::State state = cells[row * side + col];
+                unlike += (state != cells[row * side + (col + 1) % side]);
+                unlike += (state != cells[((row + 1) % side) * side + col]);
+            }
+        }
+        return static_cast<double>(unlike) / (2 * side * side);
+    }
+
+    /// Interface density of an engine whose cells can be listed in row major order.
+    template<typename Cells>
+    std::function<double(ConsensusModel&, long long)> cellInterfaceDensity(Cells cells)
+    {
+        return [cells](ConsensusModel &model, long long side) { return interfaceDensity(cells(model, side), side); };
+    }
+
+    std::vector<ConsensusModel::State> arrayCells(const ConsensusModel &model, long long side)
+    {
+        const ConsensusArray &lattice = static_cast<const ConsensusArray&>(model);
+        std::vector<ConsensusModel::State> cells;
+        cells.reserve(static_cast<std::size_t>(side * side));
+        for(long long row = 0; row < side; ++row)
+        {
+            for(long long col = 0; col < side; ++col)
+            {
+                cells.push_back(lattice(row, col));
+            }
+        }
+        return cells;
+    }
+
+    std::vector<Engine> engines()
+    {
+        std::vector<Engine> all;
+
+        all.push_back(Engine{"rowmajor",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                auto lattice = new ConsensusArray(LatticeStorage(side * side), side, side, p1, p2, ConsensusArray::RowMajor);
+                LatticeInitialiser(generator, 1).random(*lattice);
+                return std::unique_ptr<ConsensusModel>(lattice);
+            }, cellInterfaceDensity(arrayCells), false});
+
+        all.push_back(Engine{"tiled",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                auto lattice = new ConsensusArray(LatticeStorage(side * side), side, side, p1, p2, ConsensusArray::Tiled, 8);
+                LatticeInitialiser(generator, 1).random(*lattice);
+                return std::unique_ptr<ConsensusModel>(lattice);
+            }, cellInterfaceDensity(arrayCells), false});
+
+        all.push_back(Engine{"disordered",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                auto lattice = new DisorderedConsensusArray(LatticeStorage(side * side), side, side, p1, p2, ConsensusArray::RowMajor);
+                LatticeInitialiser(generator, 1).random(*lattice);
+                return std::unique_ptr<ConsensusModel>(lattice);
+            }, cellInterfaceDensity(arrayCells), false});
+
+        all.push_back(Engine{"graph",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                ConsensusGraph::Vertex vertices = static_cast<ConsensusGraph::Vertex>(side);
+                auto edges = ConsensusGraph::squareLatticeEdges(vertices, vertices);
+                return std::unique_ptr<ConsensusModel>(new ConsensusGraph(generator, vertices * vertices, edges, p1, p2, false));
+            },
+            cellInterfaceDensity([](const ConsensusModel &model, long long side) {
+                const ConsensusGraph &graph = static_cast<const ConsensusGraph&>(model);
+                std::vector<ConsensusModel::State> cells;
+                for(ConsensusGraph::Vertex vertex = 0; vertex < side * side; ++vertex)
+                {
+                    cells.push_back(graph[vertex]);
+                }
+                return cells;
+            }), false});
+
+        all.push_back(Engine{"hypercubic",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                return std::unique_ptr<ConsensusModel>(new HypercubicLattice<2>(generator, side, p1, p2));
+            },
+            cellInterfaceDensity([](const ConsensusModel &model, long long side) {
+                const HypercubicLattice<2> &lattice = static_cast<const HypercubicLattice<2>&>(model);
+                std::vector<ConsensusModel::State> cells;
+                HypercubicLattice<2>::Coordinates coordinates;
+                for(coordinates[1] = 0; coordinates[1] < side; ++coordinates[1])
+                {
+                    for(coordinates[0] = 0; coordinates[0] < side; ++coordinates[0])
+                    {
+                        cells.push_back(lattice(coordinates));
+                    }
+                }
+                return cells;
+            }), false});
+
+#ifdef CONSENSUS_MPI
+        // Each rank owns a strip of rows, and the observables are reduced over every rank.
+        all.push_back(Engine{"mpi",
+            [](std::default_random_engine &generator, long long side, double p1, double p2) {
+                return std::unique_ptr<ConsensusModel>(new DistributedConsensusArray(generator, MPI_COMM_WORLD, side, side, p1, p2));
+            },
+            [](ConsensusModel &model, long long) {
+                return static_cast<DistributedConsensusArray&>(model).interfaceDensity();
+            }, true});
+#endif
+
+        return all;
+    }
+
+    /// Runs one replica the way the main loop does.
+    Sample runReplica(const Engine &engine, std::default_random_engine &generator, long long side, double p1, double p2,
+        const std::vector<int> &times, int maxSweeps)
+    {
+        std::unique_ptr<ConsensusModel> model = engine.create(generator, side, p1, p2);
+        Sample sample{{}, {}, -1};
+
+        std::size_t nextTime = 0;
+        for(int sweep = 1; sweep <= maxSweeps; ++sweep)
+        {
+            model->sweep(generator);
+
+            if(nextTime < times.size() && sweep == times[nextTime])
+            {
+                sample.redFractions.push_back(model->stateFraction(ConsensusModel::Red));
+                sample.interfaceDensities.push_back(engine.interfaceDensity(*model, side));
+                ++nextTime;
+            }
+
+            if(sample.consensusTime < 0 && model->isAbsorbed())
+            {
+                sample.consensusTime = sweep;
+
+                // Nothing changes once absorbed, so the remaining fixed time observables are known.
+                for(; nextTime < times.size(); ++nextTime)
+                {
+                    sample.redFractions.push_back(model->stateFraction(ConsensusModel::Red));
+                    sample.interfaceDensities.push_back(0);
+                }
+                break;
+            }
+        }
+
+        return sample;
+    }
+
+    /// First sweep after which a row major lattice swept with a prefetch distance differs from one swept without, 0 if none does.
+    int firstPrefetchDifference(std::seed_seq &seeds, long long side, double p1, double p2, int distance, int maxSweeps)
+    {
+        std::default_random_engine generator(seeds);
+        std::default_random_engine plainGenerator = generator;
+
+        ConsensusArray lattice(LatticeStorage(side * side), side, side, p1, p2, ConsensusArray::RowMajor);
+        ConsensusArray plainLattice(LatticeStorage(side * side), side, side, p1, p2, ConsensusArray::RowMajor);
+        LatticeInitialiser(generator, 1).random(lattice);
+        LatticeInitialiser(plainGenerator, 1).random(plainLattice);
+        lattice.setPrefetchDistance(distance);
+        plainLattice.setPrefetchDistance(0);
+
+        const LatticeStorage &cells = lattice.getStorage();
+        const LatticeStorage &plainCells = plainLattice.getStorage();
+        for(int sweep = 1; sweep <= maxSweeps && !plainLattice.isAbsorbed(); ++sweep)
+        {
+            lattice.sweep(generator);
+            plainLattice.sweep(plainGenerator);
+            if(generator != plainGenerator || !std::equal(cells.data(), cells.data() + cells.size(), plainCells.data()))
+            {
+                return sweep;
+            }
+        }
+        return 0;
+    }
+
+    /// Complementary Kolmogorov distribution, the probability the scaled statistic exceeds lambda.
+    double kolmogorovQ(double lambda)
+    {
+        if(lambda < 1e-3)
+        {
+            return 1;
+        }
+
+        double sum = 0;
+        double sign = 1;
+        for(int term = 1; term <= 100; ++term)
+        {
+            double value = sign * std::exp(-2 * term * term * lambda * lambda);
+            sum += value;
+            if(std::fabs(value) < 1e-12 * std::fabs(sum))
+            {
+                break;
+            }
+            sign = -sign;
+        }
+        return std::max(0.0, std::min(1.0, 2 * sum));
+    }
+
+    /// Two-sample Kolmogorov-Smirnov test, returns the statistic and sets the p-value.
+    double ksTest(std::vector<double> first, std::vector<double> second, double &pValue)
+    {
+        std::sort(first.begin(), first.end());
+        std::sort(second.begin(), second.end());
+
+        double statistic = 0;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while(i < first.size() && j < second.size())
+        {
+            // Step over every copy of the smallest value in either sample so ties are handled properly.
+            double value = std::min(first[i], second[j]);
+            while(i < first.size() && first[i] == value) ++i;
+            while(j < second.size() && second[j] == value) ++j;
+
+            double distance = std::fabs(static_cast<double>(i) / first.size() - static_cast<double>(j) / second.size());
+            statistic = std::max(statistic, distance);
+        }
+
+        double effective = std::sqrt(static_cast<double>(first.size()) * second.size() / (first.size() + second.size()));
+        pValue = kolmogorovQ((effective + 0.12 + 0.11 / effective) * statistic);
+        return statistic;
+    }
+
+    /// Regularised upper incomplete gamma function Q(a, x).
+    double gammaQ(double a, double x)
+    {
+        if(x <= 0)
+        {
+            return 1;
+        }
+
+        double logPrefactor = -x + a * std::log(x) - std::lgamma(a);
+        if(x < a + 1)
+        {
+            // Series for P(a, x).
+            double term = 1 / a;
+            double sum = term;
+            for(int n = 1; n < 1000 && std::fabs(term) > 1e-15 * std::fabs(sum); ++n)
+            {
+                term *= x / (a + n);
+                sum += term;
+            }
+            return std::max(0.0, 1 - sum * std::exp(logPrefactor));
+        }
+
+        // Continued fraction for Q(a, x) by the modified Lentz method.
+        const double tiny = 1e-300;
+        double b = x + 1 - a;
+        double c = 1 / tiny;
+        double d = 1 / b;
+        double h = d;
+        for(int n = 1; n < 1000; ++n)
+        {
+            double an = -n * (n - a);
+            b += 2;
+            d = an * d + b;
+            d = std::fabs(d) < tiny ? tiny : d;
+            c = b + an / c;
+            c = std::fabs(c) < tiny ? tiny : c;
+            d = 1 / d;
+            double delta = d * c;
+            h *= delta;
+            if(std::fabs(delta - 1) < 1e-15)
+            {
+                break;
+            }
+        }
+        return std::exp(logPrefactor) * h;
+    }
+
+    /// Two-sample chi-squared test of binned counts, returns the statistic and sets the p-value.
+    double chiSquaredTest(const std::vector<long long> &first, const std::vector<long long> &second, double &pValue)
+    {
+        double firstTotal = 0;
+        double secondTotal = 0;
+        for(std::size_t bin = 0; bin < first.size(); ++bin)
+        {
+            firstTotal += first[bin];
+            secondTotal += second[bin];
+        }
+
+        double statistic = 0;
+        int degrees = -1;
+        for(std::size_t bin = 0; bin < first.size(); ++bin)
+        {
+            if(0 == first[bin] + second[bin])
+            {
+                continue;
+            }
+            double difference = std::sqrt(secondTotal / firstTotal) * first[bin] - std::sqrt(firstTotal / secondTotal) * second[bin];
+            statistic += difference * difference / (first[bin] + second[bin]);
+            ++degrees;
+        }
+
+        pValue = degrees > 0 ? gammaQ(0.5 * degrees, 0.5 * statistic) : 1;
+        return statistic;
+    }
+
+#ifdef CONSENSUS_MPI
+    /// Initialises MPI for the lifetime of main, so every return finalises it.
+    class MPISession
+    {
+    public:
+        MPISession(int &argc, char **&argv)
+        {
+            MPI_Init(&argc, &argv);
+        }
+
+        ~MPISession()
+        {
+            MPI_Finalize();
+        }
+
+        MPISession(const MPISession&) = delete;
+        MPISession& operator=(const MPISession&) = delete;
+    };
+#endif
+
+    /// Bins consensus times at the pooled quantiles, with a last bin for replicas that never reached consensus.
+    void binConsensusTimes(const std::vector<Sample> &first, const std::vector<Sample> &second, int binCount,
+        std::vector<long long> &firstCounts, std::vector<long long> &secondCounts)
+    {
+        std::vector<int> pooled;
+        for(const auto *samples : {&first, &second})
+        {
+            for(const auto &sample : *samples)
+            {
+                if(sample.consensusTime >= 0)
+                {
+                    pooled.push_back(sample.consensusTime);
+                }
+            }
+        }
+        std::sort(pooled.begin(), pooled.end());
+
+        std::vector<int> edges;
+        for(int bin = 1; bin < binCount && !pooled.empty(); ++bin)
+        {
+            int edge = pooled[pooled.size() * bin / binCount];
+            if(edges.empty() || edge > edges.back())
+            {
+                edges.push_back(edge);
+            }
+        }
+
+        auto count = [&edges](const std::vector<Sample> &samples, std::vector<long long> &counts) {
+            counts.assign(edges.size() + 2, 0);
+            for(const auto &sample : samples)
+            {
+                if(sample.consensusTime < 0)
+                {
+                    ++counts.back();
+                }
+                else
+                {
+                    ++counts[std::upper_bound(edges.begin(), edges.end(), sample.consensusTime) - edges.begin()];
+                }
+            }
+        };
+        count(first, firstCounts);
+        count(second, secondCounts);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int rank = 0;
+    int rankCount = 1;
+#ifdef CONSENSUS_MPI
+    MPISession session(argc, argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &rankCount);
+#endif
+
+    // Every rank parses the same options and stops at the same errors, only rank 0 says so.
+    std::ostream silent(nullptr);
+    std::ostream &out = (0 == rank) ? std::cout : silent;
+    std::ostream &errors = (0 == rank) ? std::cerr : silent;
+
+    std::vector<long long> sizes;
+    std::vector<double> p1Values;
+    std::vector<double> p2Values;
+    std::vector<std::string> candidateNames;
+    std::vector<int> times;
+    int replicas;
+    int maxSweeps;
+    int binCount;
+    double alpha;
+    double perturbation;
+    int threadCount;
+    std::uint64_t seed;
+    int identityReplicas;
+    int prefetchDistance;
+
+    boost::program_options::options_description desc("Options for the statistical equivalence harness");
+
+    desc.add_options()
+
+        ("sizes", boost::program_options::value<std::vector<long long>>(&sizes)->multitoken()->default_value(std::vector<long long>{16, 32}, "16 32"), "Lattice sides, multiples of 8.")
+        ("p_1,p", boost::program_options::value<std::vector<double>>(&p1Values)->multitoken()->default_value(std::vector<double>{1}, "1"), "Values of p_1.")
+        ("p_2,q", boost::program_options::value<std::vector<double>>(&p2Values)->multitoken()->default_value(std::vector<double>{0, 0.5, 1}, "0 0.5 1"), "Values of p_2.")
+        ("candidates", boost::program_options::value<std::vector<std::string>>(&candidateNames)->multitoken()->default_value(std::vector<std::string>{"tiled", "disordered", "graph", "hypercubic"}, "tiled disordered graph hypercubic"), "Engines compared with the reference: rowmajor, tiled, disordered, graph, hypercubic, and mpi when built with MPI.")
+        ("times", boost::program_options::value<std::vector<int>>(&times)->multitoken()->default_value(std::vector<int>{10, 100}, "10 100"), "Sweeps at which the fractions and interface densities are compared.")
+        ("replicas,n", boost::program_options::value<int>(&replicas)->default_value(300), "Replicas of each engine at each grid point.")
+        ("max-sweeps,s", boost::program_options::value<int>(&maxSweeps)->default_value(2000), "Sweeps after which a replica that has not reached consensus is stopped.")
+        ("bins", boost::program_options::value<int>(&binCount)->default_value(8), "Bins of the consensus time chi-squared test, plus one for no consensus.")
+        ("alpha", boost::program_options::value<double>(&alpha)->default_value(0.01), "Probability of a false failure over the whole run.")
+        ("perturb", boost::program_options::value<double>(&perturbation)->default_value(0), "Run the candidates at p_2 plus this, to check a real difference is caught.")
+        ("threads,t", boost::program_options::value<int>(&threadCount)->default_value(0), "Number of threads running replicas, 0 uses every hardware thread.")
+        ("seed", boost::program_options::value<std::uint64_t>(&seed)->default_value(1), "Seed of the replica generators.")
+        ("identity-replicas", boost::program_options::value<int>(&identityReplicas)->default_value(10), "Row major replicas at each grid point that must give the same trajectory with and without prefetching.")
+        ("prefetch", boost::program_options::value<int>(&prefetchDistance)->default_value(ConsensusArray::defaultPrefetchDistance), "Prefetch distance of the pipelined sweep checked against prefetching off.")
+        ("help,h", "Produce help message");
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc,argv,desc), vm);
+    boost::program_options::notify(vm);
+
+    if(vm.count("help"))
+    {
+        out << desc << '\n';
+        return 1;
+    }
+
+    Timer timer;
+    if(threadCount <= 0)
+    {
+        threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+
+    // A replica records each fixed time once, when it reaches it, so every one must be a sweep it can run.
+    if(times.empty() || times.front() < 1 || times.back() > maxSweeps)
+    {
+        errors << "--times needs sweeps between 1 and --max-sweeps (" << maxSweeps << ").\n";
+        return 1;
+    }
+
+    std::vector<Engine> allEngines = engines();
+    auto findEngine = [&allEngines](const std::string &name) -> const Engine* {
+        for(const auto &engine : allEngines)
+        {
+            if(engine.name == name)
+            {
+                return &engine;
+            }
+        }
+        return nullptr;
+    };
+
+    // The reference is run once per grid point and compared with every candidate.
+    std::vector<const Engine*> runEngines{findEngine("rowmajor")};
+    for(const auto &name : candidateNames)
+    {
+        const Engine *engine = findEngine(name);
+        if(!engine)
+        {
+            errors << "Unknown engine: " << name << '\n';
+            return 1;
+        }
+        runEngines.push_back(engine);
+    }
+
+    // A distributed lattice gives every rank a strip of at least four rows.
+    bool collective = std::any_of(runEngines.begin(), runEngines.end(), [](const Engine *engine) { return engine->collective; });
+    if(collective && std::any_of(sizes.begin(), sizes.end(), [rankCount](long long side) { return side < 4LL * rankCount; }))
+    {
+        errors << "The mpi candidate needs sides of at least " << 4LL * rankCount << " for " << rankCount << " ranks.\n";
+        return 1;
+    }
+
+    struct Point
+    {
+        long long side;
+        double p1;
+        double p2;
+    };
+    std::vector<Point> grid;
+    for(long long side : sizes)
+    {
+        for(double p1 : p1Values)
+        {
+            for(double p2 : p2Values)
+            {
+                grid.push_back(Point{side, p1, p2});
+            }
+        }
+    }
+
+    // Every replica of every engine at every point is an independent job with its own stream.
+    long long jobsPerPoint = static_cast<long long>(runEngines.size()) * replicas;
+    long long jobCount = static_cast<long long>(grid.size()) * jobsPerPoint;
+    std::vector<Sample> samples(static_cast<std::size_t>(jobCount));
+
+    // Replicas split over the ranks are run one at a time by every rank together, each rank seeding
+    // its strip and updates with its own rank added to the job's seed.
+    for(long long job = 0; job < jobCount && collective; ++job)
+    {
+        const Point &point = grid[job / jobsPerPoint];
+        std::size_t engine = static_cast<std::size_t>((job % jobsPerPoint) / replicas);
+        if(!runEngines[engine]->collective)
+        {
+            continue;
+        }
+        double p2 = point.p2 + (engine > 0 ? perturbation : 0);
+
+        std::uint64_t bits = counterRandom(seed, static_cast<std::uint64_t>(job));
+        std::seed_seq seeds{static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits), static_cast<std::uint32_t>(rank)};
+        std::default_random_engine generator(seeds);
+        samples[job] = runReplica(*runEngines[engine], generator, point.side, point.p1, p2, times, maxSweeps);
+    }
+
+    // Rank 0 runs everything else and reports.
+    if(0 != rank)
+    {
+        return 0;
+    }
+
+    parallelFor(threadCount, jobCount, 1, [&](int, long long begin, long long end) {
+        for(long long job = begin; job < end; ++job)
+        {
+            const Point &point = grid[job / jobsPerPoint];
+            std::size_t engine = static_cast<std::size_t>((job % jobsPerPoint) / replicas);
+            double p2 = point.p2 + (engine > 0 ? perturbation : 0);
+            if(runEngines[engine]->collective)
+            {
+                continue;
+            }
+
+            std::uint64_t bits = counterRandom(seed, static_cast<std::uint64_t>(job));
+            std::seed_seq seeds{static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits)};
+            std::default_random_engine generator(seeds);
+            samples[job] = runReplica(*runEngines[engine], generator, point.side, point.p1, p2, times, maxSweeps);
+        }
+    });
+
+    // The identity runs use streams after those of the statistical jobs.
+    identityReplicas = std::max(0, identityReplicas);
+    long long identityCount = static_cast<long long>(grid.size()) * identityReplicas;
+    std::vector<int> differences(static_cast<std::size_t>(identityCount));
+
+    parallelFor(threadCount, identityCount, 1, [&](int, long long begin, long long end) {
+        for(long long job = begin; job < end; ++job)
+        {
+            const Point &point = grid[job / identityReplicas];
+            std::uint64_t bits = counterRandom(seed, static_cast<std::uint64_t>(jobCount + job));
+            std::seed_seq seeds{static_cast<std::uint32_t>(bits >> 32), static_cast<std::uint32_t>(bits)};
+            differences[job] = firstPrefetchDifference(seeds, point.side, point.p1, point.p2, prefetchDistance, maxSweeps);
+        }
+    });
+
+    // Each candidate gets a KS test per observable and time, and one chi-squared test, at every point.
+    long long testCount = static_cast<long long>(grid.size()) * (runEngines.size() - 1) * (2 * times.size() + 1);
+    double threshold = alpha / testCount;
+    bool passed = true;
+
+    int columnWidth = 12;
+    out << std::setw(columnWidth) << "engine" << std::setw(6) << "L" << std::setw(8) << "p_1" << std::setw(8) << "p_2"
+              << std::setw(22) << "test" << std::setw(columnWidth) << "statistic" << std::setw(columnWidth) << "p-value" << "  result\n";
+
+    auto report = [&](const std::string &engine, const Point &point, const std::string &test, double statistic, double pValue) {
+        bool ok = pValue >= threshold;
+        passed = passed && ok;
+        out << std::setw(columnWidth) << engine << std::setw(6) << point.side << std::setw(8) << point.p1 << std::setw(8) << point.p2
+                  << std::setw(22) << test << std::setw(columnWidth) << statistic << std::setw(columnWidth) << pValue
+                  << "  " << (ok ? "pass" : "FAIL") << '\n';
+    };
+
+    for(std::size_t point = 0; point < grid.size(); ++point)
+    {
+        auto first = samples.begin() + static_cast<long long>(point) * jobsPerPoint;
+        std::vector<Sample> reference(first, first + replicas);
+
+        for(std::size_t engine = 1; engine < runEngines.size(); ++engine)
+        {
+            std::vector<Sample> candidate(first + engine * replicas, first + (engine + 1) * replicas);
+
+            for(std::size_t time = 0; time < times.size(); ++time)
+            {
+                std::vector<double> referenceRed, candidateRed, referenceInterface, candidateInterface;
+                for(int replica = 0; replica < replicas; ++replica)
+                {
+                    referenceRed.push_back(reference[replica].redFractions[time]);
+                    candidateRed.push_back(candidate[replica].redFractions[time]);
+                    referenceInterface.push_back(reference[replica].interfaceDensities[time]);
+                    candidateInterface.push_back(candidate[replica].interfaceDensities[time]);
+                }
+
+                double pValue;
+                double statistic = ksTest(referenceRed, candidateRed, pValue);
+                report(runEngines[engine]->name, grid[point], "KS red t=" + std::to_string(times[time]), statistic, pValue);
+                statistic = ksTest(referenceInterface, candidateInterface, pValue);
+                report(runEngines[engine]->name, grid[point], "KS interface t=" + std::to_string(times[time]), statistic, pValue);
+            }
+
+            std::vector<long long> referenceCounts, candidateCounts;
+            binConsensusTimes(reference, candidate, binCount, referenceCounts, candidateCounts);
+            double pValue;
+            double statistic = chiSquaredTest(referenceCounts, candidateCounts, pValue);
+            report(runEngines[engine]->name, grid[point], "chi2 consensus time", statistic, pValue);
+        }
+
+        if(identityReplicas > 0)
+        {
+            // The statistic is the number of replicas whose trajectories differ, which must be none.
+            auto firstDifference = differences.begin() + static_cast<long long>(point) * identityReplicas;
+            long long differing = std::count_if(firstDifference, firstDifference + identityReplicas, [](int sweep) { return sweep > 0; });
+            passed = passed && 0 == differing;
+            out << std::setw(columnWidth) << "rowmajor" << std::setw(6) << grid[point].side << std::setw(8) << grid[point].p1 << std::setw(8) << grid[point].p2
+                      << std::setw(22) << "prefetch " + std::to_string(prefetchDistance) + " identity" << std::setw(columnWidth) << differing
+                      << std::setw(columnWidth) << "-" << "  " << (0 == differing ? "pass" : "FAIL") << '\n';
+        }
+    }
+
+    out << '\n' << testCount << " tests at alpha " << alpha << " (each p-value must be at least " << threshold << ") and "
+              << identityCount << " identical trajectories: "
+              << (passed ? "PASSED" : "FAILED") << " in " << timer.elapsed() << " s\n";
+
+    return passed ? 0 : 1;
+}